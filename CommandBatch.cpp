@@ -0,0 +1,114 @@
+#include "CommandBatch.h"
+#include "portmanager.h"
+
+CommandBatch::CommandBatch(PortManager *portManager, QObject *parent) : QObject(parent), _portManager(portManager)
+{
+}
+
+CommandBatch *CommandBatch::switchSWD(int slot)
+{
+    return add<MbSwitchSwd>(slot);
+}
+
+CommandBatch *CommandBatch::powerOn(int slot)
+{
+    return add<MbSwitchPower>(slot, 1);
+}
+
+CommandBatch *CommandBatch::powerOff(int slot)
+{
+    return add<MbSwitchPower>(slot, 0);
+}
+
+CommandBatch *CommandBatch::readDIN(int slot, int DIN)
+{
+    return add<MbReadDin>(slot, DIN);
+}
+
+CommandBatch *CommandBatch::setDOUT(int slot, int DOUT)
+{
+    return add<MbWriteDout>(slot, DOUT, 1);
+}
+
+CommandBatch *CommandBatch::clearDOUT(int slot, int DOUT)
+{
+    return add<MbWriteDout>(slot, DOUT, 0);
+}
+
+CommandBatch *CommandBatch::readCSA(int gain)
+{
+    return add<MbReadCsa>(gain);
+}
+
+CommandBatch *CommandBatch::readAIN(int slot, int AIN, int gain)
+{
+    return add<MbReadAnalog>(slot, AIN, gain);
+}
+
+CommandBatch *CommandBatch::daliOn()
+{
+    return add<MbSwitchDali>(1);
+}
+
+CommandBatch *CommandBatch::daliOff()
+{
+    return add<MbSwitchDali>(0);
+}
+
+CommandBatch *CommandBatch::readDaliADC()
+{
+    return add<MbReadDaliAdc>();
+}
+
+CommandBatch *CommandBatch::readDinADC(int slot, int DIN)
+{
+    return add<MbReadDinAdc>(slot, DIN);
+}
+
+CommandBatch *CommandBatch::read24V()
+{
+    return add<MbReadAdc24V>();
+}
+
+CommandBatch *CommandBatch::read3V()
+{
+    return add<MbReadAdc3V>();
+}
+
+CommandBatch *CommandBatch::readTemperature()
+{
+    return add<MbReadAdcTemp>();
+}
+
+QVariantList CommandBatch::submit()
+{
+    QList<QByteArray> packets;
+
+    for (auto & packet : _packets)
+    {
+        if (!packet.isEmpty())
+            packets.append(packet);
+    }
+
+    auto responses = _portManager->slipBatch(packets);
+    QVariantList results;
+    int next = 0;
+
+    for (auto & packet : _packets)
+    {
+        if (packet.isEmpty())
+        {
+            results.append(int(MB_ERROR_INVALID_ARGUMENT));
+            continue;
+        }
+
+        auto response = responses.value(next++);
+
+        results.append(response.isEmpty() ? -1 : response.toInt());
+    }
+
+    emit submitted(_packets, results);
+
+    _packets.clear();
+    return results;
+}
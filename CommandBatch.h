@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QVariantList>
+
+#include "MbCodec.h"
+#include "Logger.h"
+
+class PortManager;
+
+// Measuring board commands collected for one MB_BATCH round trip.
+//
+// Every command returns the batch, so calls chain the same way in C++ and in the test
+// sequences: testClient.batch().powerOn(1).powerOn(2).readCSA(0).submit(). submit() sends
+// the commands and returns their results in call order, as the single-command functions
+// of TestClient would have returned them.
+
+class CommandBatch : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit CommandBatch(PortManager *portManager, QObject *parent = nullptr);
+
+    void setLogger(const QSharedPointer<Logger> &logger) {_logger = logger;}
+
+    int size() const {return _packets.size();}
+
+    // Validates and queues one MB_COMMAND_TABLE command.
+    template <typename Command, typename... Values>
+    CommandBatch *add(Values... values);
+
+public slots:
+
+    CommandBatch *switchSWD(int slot);
+    CommandBatch *powerOn(int slot);
+    CommandBatch *powerOff(int slot);
+    CommandBatch *readDIN(int slot, int DIN);
+    CommandBatch *setDOUT(int slot, int DOUT);
+    CommandBatch *clearDOUT(int slot, int DOUT);
+    CommandBatch *readCSA(int gain);
+    CommandBatch *readAIN(int slot, int AIN, int gain);
+    CommandBatch *daliOn();
+    CommandBatch *daliOff();
+    CommandBatch *readDaliADC();
+    CommandBatch *readDinADC(int slot, int DIN);
+    CommandBatch *read24V();
+    CommandBatch *read3V();
+    CommandBatch *readTemperature();
+
+    // Result codes as ints, -1 where the board did not answer. The batch is empty afterwards.
+    QVariantList submit();
+    void clear() {_packets.clear();}
+
+signals:
+
+    // The packets of a submitted batch, empty for rejected commands, with their results.
+    void submitted(const QList<QByteArray> &packets, const QVariantList &results);
+
+private:
+
+    PortManager *_portManager;
+    QSharedPointer<Logger> _logger;
+
+    // An empty packet stands for a command rejected by its argument check.
+    QList<QByteArray> _packets;
+};
+
+template <typename Command, typename... Values>
+CommandBatch *CommandBatch::add(Values... values)
+{
+    if (Command::isValid(values...))
+    {
+        _packets.append(Command::encode(values...));
+    }
+
+    else
+    {
+        _logger->logError(QString("Invalid argument for the measuring board command %1.").arg(Command::type));
+        _packets.append(QByteArray());
+    }
+
+    return this;
+}
@@ -0,0 +1,150 @@
+#include "CrcCcitt.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define CRC_CCITT_CLMUL
+    #include <emmintrin.h>
+    #include <tmmintrin.h>
+    #include <wmmintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define CLMUL_TARGET
+    #else
+        #define CLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+    #endif
+#endif
+
+static constexpr quint32 CRC_CCITT_POLY = 0x11021;
+
+// The carry-less multiply kernel only pays off once a few blocks can be folded.
+static constexpr int CLMUL_MIN_SIZE = 64;
+
+// slice[k][b] is the CRC (zero initial value) of byte b followed by k zero bytes.
+struct CrcTables
+{
+    quint16 slice[8][256];
+
+    CrcTables()
+    {
+        for (int b = 0; b < 256; ++b)
+        {
+            quint16 crc = b << 8;
+
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc & 0x8000) ? (crc << 1) ^ CRC_CCITT_POLY : crc << 1;
+
+            slice[0][b] = crc;
+        }
+
+        for (int k = 1; k < 8; ++k)
+            for (int b = 0; b < 256; ++b)
+                slice[k][b] = (slice[k - 1][b] << 8) ^ slice[0][slice[k - 1][b] >> 8];
+    }
+};
+
+static const CrcTables _tables;
+
+static quint16 crcSliceBy8(quint16 crc, const quint8 *p, int size) Q_DECL_NOTHROW
+{
+    const auto &t = _tables.slice;
+
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        crc ^= (p[0] << 8) | p[1];
+        crc = t[7][crc >> 8] ^ t[6][crc & 0xFF]
+            ^ t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+
+    for (; size > 0; ++p, --size)
+        crc = t[0][*p ^ (crc >> 8)] ^ (crc << 8);
+
+    return crc;
+}
+
+#ifdef CRC_CCITT_CLMUL
+
+// x^n mod P, the folding constants of the carry-less multiply kernel.
+static quint64 xPowerModPoly(int n)
+{
+    quint32 r = 1;
+
+    while (n--)
+    {
+        r <<= 1;
+        if (r & 0x10000)
+            r ^= CRC_CCITT_POLY;
+    }
+
+    return r;
+}
+
+static bool cpuHasClmul()
+{
+#if defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 1);
+    return (info[2] & (1 << 1)) && (info[2] & (1 << 9)); // PCLMULQDQ, SSSE3
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+#endif
+}
+
+// The message is read as a big endian polynomial in 128-bit blocks. The accumulator
+// R is folded into the next block as R * x^128 = Rhi * x^192 + Rlo * x^128, with both
+// powers reduced modulo P to 16-bit constants, which keeps R congruent to the message
+// read so far. The last 16 accumulator bytes and the tail then go through the tables.
+CLMUL_TARGET static quint16 crcClmul(quint16 crc, const quint8 *p, int size) Q_DECL_NOTHROW
+{
+    static const quint64
+        K128 = xPowerModPoly(128),
+        K192 = xPowerModPoly(192);
+
+    const __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i k = _mm_set_epi64x(qint64(K128), qint64(K192));
+
+    // The running CRC is XORed into the first 16 message bits.
+    __m128i r = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), swap);
+    r = _mm_xor_si128(r, _mm_set_epi64x(qint64(quint64(crc) << 48), 0));
+    p += 16;
+    size -= 16;
+
+    for (; size >= 16; p += 16, size -= 16)
+    {
+        __m128i block = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), swap);
+
+        r = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(r, k, 0x01), _mm_clmulepi64_si128(r, k, 0x10)), block);
+    }
+
+    alignas(16) quint8 folded[16];
+
+    _mm_store_si128(reinterpret_cast<__m128i*>(folded), _mm_shuffle_epi8(r, swap));
+
+    return crcSliceBy8(crcSliceBy8(0, folded, sizeof(folded)), p, size);
+}
+
+static const bool _hasClmul = cpuHasClmul();
+
+#endif
+
+quint16 crcCcitt(quint16 crc, const void *data, int size) Q_DECL_NOTHROW
+{
+    auto p = static_cast<const quint8*>(data);
+
+#ifdef CRC_CCITT_CLMUL
+    if (size >= CLMUL_MIN_SIZE && _hasClmul)
+        return crcClmul(crc, p, size);
+#endif
+
+    return crcSliceBy8(crc, p, size);
+}
+
+const char *crcCcittImplementation()
+{
+#ifdef CRC_CCITT_CLMUL
+    if (_hasClmul)
+        return "PCLMULQDQ";
+#endif
+
+    return "slice-by-8";
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QtGlobal>
+
+// CRC-16/CCITT (polynomial 0x1021, MSB first, no final XOR) used by the SLIP framing.
+//
+// crc is the running value, so a message can be processed in pieces; start with
+// CRC_CCITT_INIT. Running the CRC over a message followed by its own big endian
+// CRC yields zero. Large blocks use a carry-less multiply kernel when the CPU has
+// PCLMULQDQ, otherwise a slice-by-8 table walk.
+
+static constexpr quint16 CRC_CCITT_INIT = 0xFFFF;
+
+quint16 crcCcitt(quint16 crc, const void *data, int size) Q_DECL_NOTHROW;
+
+// Implementation chosen at runtime, for logging.
+const char *crcCcittImplementation();
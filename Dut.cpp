@@ -0,0 +1,70 @@
+#include "Dut.h"
+
+template <typename T>
+static quint32 assign(T &field, const T &value, quint32 fields)
+{
+    if (field == value)
+        return 0;
+
+    field = value;
+    return fields;
+}
+
+DutCheck Dut::checkOf(const QString &name)
+{
+#define DUT_CHECK_NAME(flag, property) if (name == QLatin1String(property)) return flag;
+    DUT_CHECK_TABLE(DUT_CHECK_NAME)
+#undef DUT_CHECK_NAME
+
+    return DutCheckCount;
+}
+
+QVariant Dut::property(const QString &name) const
+{
+    if (name == QLatin1String("state"))
+        return state;
+    if (name == QLatin1String("checked"))
+        return checked;
+    if (name == QLatin1String("no"))
+        return no;
+    if (name == QLatin1String("id"))
+        return id;
+    if (name == QLatin1String("error"))
+        return error;
+
+    auto flag = checkOf(name);
+
+    if (flag != DutCheckCount)
+        return check(flag);
+
+    return properties.value(name);
+}
+
+quint32 Dut::setProperty(const QString &name, const QVariant &value)
+{
+    if (name == QLatin1String("state"))
+        return assign(state, value.toInt(), DutStateField);
+    if (name == QLatin1String("checked"))
+        return assign(checked, value.toBool(), DutCheckedField);
+    if (name == QLatin1String("no"))
+        return assign(no, value.toInt(), DutAllFields);
+    if (name == QLatin1String("id"))
+        return assign(id, value.toString(), DutIdField);
+    if (name == QLatin1String("error"))
+        return assign(error, value.toString(), DutErrorField);
+
+    auto flag = checkOf(name);
+
+    if (flag != DutCheckCount)
+    {
+        auto previous = checks;
+        setCheck(flag, value.toBool());
+        return checks != previous ? DutChecksField : 0;
+    }
+
+    if (properties.value(name) == value && properties.contains(name))
+        return 0;
+
+    properties.insert(name, value);
+    return DutPropertiesField;
+}
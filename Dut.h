@@ -1,27 +1,86 @@
 #pragma once
 
 #include <QVariant>
+#include <QVector>
+#include <QMetaType>
 
 enum DutState {inactive, untested, tested, warning};
 
-using Dut = QMap<QString, QVariant>;
-
-static Dut dutTemplate {
-    {"state", DutState::inactive},
-    {"id", ""},
-    {"no", 0},
-    {"railtestDownloaded", false},
-    {"checked", false},
-    {"voltageChecked", false},
-    {"accelChecked", false},
-    {"lightSensChecked", false},
-    {"daliChecked", false},
-    {"radioChecked", false},
-    {"gnssChecked", false},
-    {"rtcChecked", false},
-    {"error", ""}
+// Pass/fail flags of a DUT: X(enum name, script property name).
+#define DUT_CHECK_TABLE(X) \
+    X(RailtestDownloaded,   "railtestDownloaded") \
+    X(VoltageChecked,       "voltageChecked") \
+    X(AccelChecked,         "accelChecked") \
+    X(LightSensChecked,     "lightSensChecked") \
+    X(DaliChecked,          "daliChecked") \
+    X(RadioChecked,         "radioChecked") \
+    X(GnssChecked,          "gnssChecked") \
+    X(RtcChecked,           "rtcChecked") \
+    X(DoutChecked,          "doutChecked")
+
+enum DutCheck
+{
+#define DUT_CHECK_ENUM(name, property) name,
+    DUT_CHECK_TABLE(DUT_CHECK_ENUM)
+#undef DUT_CHECK_ENUM
+    DutCheckCount
+};
+
+// Parts of a Dut a change notification covers.
+enum DutField
+{
+    DutStateField       = 0x01,
+    DutCheckedField     = 0x02,
+    DutIdField          = 0x04,
+    DutErrorField       = 0x08,
+    DutChecksField      = 0x10,
+    DutPropertiesField  = 0x20,
+    DutAllFields        = 0x3f
 };
 
+// One DUT of a test board.
+//
+// The fields the test sequences poll in every loop are plain members, the check flags
+// are bits indexed by DutCheck. Anything else a script stores goes into a small side
+// table. property()/setProperty() keep the script names of the former key-value map
+// ("state", "checked", "voltageChecked", ...), so dutProperty/setDutProperty work as before.
+struct Dut
+{
+    int no = 0;
+    int state = DutState::inactive;
+    bool checked = false;
+    QString id;
+    QString error;
+    quint32 checks = 0;
+    QVariantMap properties;
+
+    bool isAvailable() const {return state != DutState::inactive;}
+
+    bool check(DutCheck flag) const {return checks & (1u << flag);}
+    void setCheck(DutCheck flag, bool value) {checks = value ? checks | (1u << flag) : checks & ~(1u << flag);}
+
+    QVariant property(const QString &name) const;
+
+    // Returns the DutField bits that actually changed, 0 for a write of the current value.
+    quint32 setProperty(const QString &name, const QVariant &value);
+
+    // Check flag of a script property name, or DutCheckCount.
+    static DutCheck checkOf(const QString &name);
+};
+
+Q_DECLARE_METATYPE(Dut)
+
+// A DUT after a batch of writes, with the DutField bits the batch touched.
+struct DutChange
+{
+    Dut dut;
+    quint32 fields = 0;
+};
+
+typedef QVector<DutChange> DutChanges;
+
+Q_DECLARE_METATYPE(DutChanges)
+
 struct DutRecord
 {
     QString runningNumber;
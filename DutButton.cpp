@@ -30,6 +30,10 @@ void DutButton::setChecked(bool checked)
 
 void DutButton::setButtonState(int state)
 {
+    // A style sheet change restyles the button, skip it when the state stays the same.
+    if (state == _state)
+        return;
+
     _state = state;
     setStyleSheet(_stateStyles[_state]);
 }
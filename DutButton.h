@@ -28,6 +28,6 @@ public slots:
 private:
 
     int _no;
-    int _state;
+    int _state = -1;
     QMap<int, QString> _stateStyles;
 };
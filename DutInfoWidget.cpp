@@ -47,7 +47,7 @@ DutInfoWidget::DutInfoWidget(SessionManager *session, QWidget *parent) : QWidget
 
     for (int no = 1; no < 16; no++)
     {
-        _duts.insert(no, dutTemplate);
+        _duts.insert(no, Dut());
     }
 }
 
@@ -59,10 +59,10 @@ void DutInfoWidget::showDutInfo(int no)
     auto dut = _duts[no];
 
     _slot->setText(_slotTemplate.arg(no));
-    _id->setText(_idTemplate.arg(dut["id"].toString()));
+    _id->setText(_idTemplate.arg(dut.id));
 
     QString stateDescription;
-    switch (dut["state"].toInt())
+    switch (dut.state)
     {
         case DutState::inactive:
         stateDescription = "The device is not avaliable now.";
@@ -94,7 +94,7 @@ void DutInfoWidget::showDutInfo(int no)
 //        _errorDesc->setText("");
 //    }
 
-    if(dut["checked"].toBool())
+    if(dut.checked)
     {
         _checkState->setText("CHECKED for a further testing.");
     }
@@ -105,14 +105,27 @@ void DutInfoWidget::showDutInfo(int no)
     }
 }
 
-void DutInfoWidget::updateDut(Dut dut)
+void DutInfoWidget::updateDuts(const DutChanges &changes)
 {
     QMutexLocker locker(&_updateMutex);
-    _duts[dut["no"].toInt()] = dut;
-    showDutInfo(dut["no"].toInt());
+
+    // Only the panel fields are worth a repaint, errors and check flags are not shown.
+    const quint32 shownFields = DutStateField | DutCheckedField | DutIdField;
+    int no = 0;
+
+    for (auto & change : changes)
+    {
+        _duts[change.dut.no] = change.dut;
+
+        if (change.fields & shownFields)
+            no = change.dut.no;
+    }
+
+    if (no)
+        showDutInfo(no);
 }
 
 void DutInfoWidget::setDutChecked(int no, bool checked)
 {
-    _duts[no]["checked"] = checked;
+    _duts[no].checked = checked;
 }
@@ -20,7 +20,7 @@ public:
 public slots:
 
     void showDutInfo(int no);
-    void updateDut(Dut dut);
+    void updateDuts(const DutChanges &changes);
     void setDutChecked(int no, bool checked);
 
 private:
@@ -0,0 +1,114 @@
+#include "LatencyHistogram.h"
+
+#include <QtAlgorithms>
+
+constexpr int
+    LatencyHistogram::SUB_BUCKETS,
+    LatencyHistogram::BUCKET_COUNT;
+
+int LatencyHistogram::bucketOf(qint64 usecs) Q_DECL_NOTHROW
+{
+    if (usecs < SUB_BUCKETS)
+        return int(qMax<qint64>(0, usecs));
+
+    // The leading one and the next three bits pick the bucket.
+    int exponent = 63 - qCountLeadingZeroBits(quint64(usecs));
+    int shift = exponent - 3;
+    int bucket = SUB_BUCKETS * (exponent - 2) + int(usecs >> shift) - SUB_BUCKETS;
+
+    return qMin(bucket, BUCKET_COUNT - 1);
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int bucket) Q_DECL_NOTHROW
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    int shift = bucket / SUB_BUCKETS - 1;
+    qint64 mantissa = SUB_BUCKETS + bucket % SUB_BUCKETS;
+
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::add(qint64 usecs, quint32 weight) Q_DECL_NOTHROW
+{
+    _buckets[bucketOf(usecs)] += weight;
+
+    if (!_count || usecs < _min)
+        _min = usecs;
+    if (usecs > _max)
+        _max = usecs;
+
+    _count += weight;
+    _sum += double(usecs) * weight;
+}
+
+void LatencyHistogram::age() Q_DECL_NOTHROW
+{
+    quint64 count = 0;
+    int first = -1;
+    int last = -1;
+
+    // A bucket with a single sample left empties, so a past outlier does not stay forever.
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+    {
+        _buckets[bucket] /= 2;
+        count += _buckets[bucket];
+
+        if (_buckets[bucket])
+        {
+            if (first < 0)
+                first = bucket;
+            last = bucket;
+        }
+    }
+
+    if (!count)
+    {
+        reset();
+        return;
+    }
+
+    _sum = _sum * count / _count;
+    _count = count;
+    _min = qMax(_min, first ? bucketUpperBound(first - 1) + 1 : 0);
+    _max = qMin(_max, bucketUpperBound(last));
+}
+
+void LatencyHistogram::reset() Q_DECL_NOTHROW
+{
+    *this = LatencyHistogram();
+}
+
+qint64 LatencyHistogram::percentile(double fraction) const Q_DECL_NOTHROW
+{
+    if (!_count)
+        return 0;
+
+    quint64 rank = quint64(qBound(0.0, fraction, 1.0) * _count + 0.5);
+    quint64 seen = 0;
+
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+    {
+        seen += _buckets[bucket];
+        if (seen >= qMax<quint64>(rank, 1))
+            return qMin(bucketUpperBound(bucket), _max);
+    }
+
+    return _max;
+}
+
+QVariantMap LatencyHistogram::toVariantMap() const
+{
+    QVariantMap result;
+
+    result.insert("count", _count);
+    result.insert("min", min());
+    result.insert("mean", mean());
+    result.insert("p50", percentile(0.5));
+    result.insert("p90", percentile(0.9));
+    result.insert("p99", percentile(0.99));
+    result.insert("max", _max);
+
+    return result;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QVariantMap>
+
+// Log-linear latency histogram in microseconds.
+//
+// Values below 8 us get a bucket each; above that every power of two is split into
+// 8 buckets, so a percentile is within 12.5% of the true value at any scale. Adding
+// a sample is a few integer operations and never allocates. age() halves every bucket,
+// so recent samples outweigh old ones.
+
+class LatencyHistogram
+{
+public:
+
+    // weight counts the sample that many times.
+    void add(qint64 usecs, quint32 weight = 1) Q_DECL_NOTHROW;
+    void age() Q_DECL_NOTHROW;
+    void reset() Q_DECL_NOTHROW;
+
+    quint64 count() const {return _count;}
+    qint64 min() const {return _count ? _min : 0;}
+    qint64 max() const {return _max;}
+    qint64 mean() const {return _count ? qint64(_sum / _count) : 0;}
+
+    // Upper bound of the bucket holding the given fraction (0..1) of the samples.
+    qint64 percentile(double fraction) const Q_DECL_NOTHROW;
+
+    // count, min, mean, p50, p90, p99 and max in microseconds.
+    QVariantMap toVariantMap() const;
+
+private:
+
+    static constexpr int SUB_BUCKETS = 8;
+    static constexpr int BUCKET_COUNT = SUB_BUCKETS * 32;
+
+    static int bucketOf(qint64 usecs) Q_DECL_NOTHROW;
+    static qint64 bucketUpperBound(int bucket) Q_DECL_NOTHROW;
+
+    quint32 _buckets[BUCKET_COUNT] = {};
+    quint64 _count = 0;
+    qint64 _min = 0;
+    qint64 _max = 0;
+    double _sum = 0;
+};
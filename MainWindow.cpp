@@ -8,14 +8,23 @@
 #include <QHBoxLayout>
 #include <QFormLayout>
 #include <QCompleter>
-#include <QSerialPortInfo>
 #include <QMessageBox>
 #include <QCloseEvent>
+#include <QDir>
+#include <QDateTime>
+
+#include "TrafficRecorder.h"
+#include "SerialPortRegistry.h"
+#include "ReferenceRadio.h"
+#include "CommandBatch.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QWidget(parent)
 {
     thread()->setObjectName("Main Window thread");
+    qRegisterMetaType<Dut>("Dut");
+    qRegisterMetaType<DutChanges>("DutChanges");
+    qRegisterMetaType<CommandBatch*>("CommandBatch*");
     setStyleSheet("color: #424242; font-size:10pt;");    
 
     _settings = QSharedPointer<QSettings>::create(_workDirectory + "/settings.ini", QSettings::IniFormat);
@@ -23,12 +32,24 @@ MainWindow::MainWindow(QWidget *parent)
 
     _session = new SessionManager(_settings, this);
     _logger = QSharedPointer<Logger>::create(_settings, _session);
+
+    // Serial traffic of all ports goes to a capture file for offline replay.
+    if(_settings->value("Debug/trafficCapture").toBool())
+    {
+        QDir(_workDirectory).mkpath("captures");
+        auto captureFile = _workDirectory + "/captures/" + QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss") + ".ftcap";
+
+        if(!TrafficRecorder::instance()->start(captureFile))
+            _logger->logError("Cannot create traffic capture file " + captureFile);
+    }
+
     _printerManager = new PrinterManager(_settings, this);
     _printerManager->setLogger(_logger);
     _methodManager = new TestMethodManager(_settings);
     _methodManager->setLogger(_logger);
 
-    auto availablePorts = QSerialPortInfo::availablePorts();
+    // Enumerates the serial ports once, here in the main thread; the test clients only look them up.
+    SerialPortRegistry::instance();
 
     //Setting number of active measuring boards (max - 5)
     const int MAX_MEASBOARD_COUNT = 5;
@@ -57,6 +78,12 @@ MainWindow::MainWindow(QWidget *parent)
             _testClientList.push_back(testClient);
             _testClientList.last()->setDutsNumbers(_settings->value(QString("TestBoard/duts" + QString().setNum(i + 1))).toString());
 
+            for (int slot = 1; slot <= testClient->dutsCount(); slot++)
+            {
+                if (testClient->dutNo(slot))
+                    _dutSlots.insert(testClient->dutNo(slot), qMakePair(testClient, slot));
+            }
+
 //            for (auto & portInfo : availablePorts)
 //            {
 //                if(portInfo.serialNumber() == _settings->value(QString("Railtest/serialID%1").arg(QString().setNum(i + 1))).toString())
@@ -315,9 +342,9 @@ MainWindow::MainWindow(QWidget *parent)
 
     for (auto & testClient : _testClientList)
     {
-        connect(testClient, &TestClient::dutChanged, _testFixtureWidget, &TestFixtureWidget::refreshButtonState, Qt::QueuedConnection);
+        connect(testClient, &TestClient::dutsChanged, _testFixtureWidget, &TestFixtureWidget::refreshButtonStates, Qt::QueuedConnection);
         connect(_testFixtureWidget, &TestFixtureWidget::dutClicked, testClient, &TestClient::setDutChecked, Qt::QueuedConnection);
-        connect(testClient, &TestClient::dutChanged, _dutInfoWidget, &DutInfoWidget::updateDut, Qt::QueuedConnection);
+        connect(testClient, &TestClient::dutsChanged, _dutInfoWidget, &DutInfoWidget::updateDuts, Qt::QueuedConnection);
         connect(testClient, &TestClient::dutFullyTested, _session, &SessionManager::logDutInfo, Qt::QueuedConnection);
     }
 
@@ -426,6 +453,7 @@ void MainWindow::finishSession()
     setControlsEnabled(false);
     _session->writeDutRecordsToDatabase();
     _session->clear();
+    ReferenceRadio::closeAll();
 
     _settings->setValue("lastMethod", _selectMetodBox->currentText());
     _selectMetodBox->clear();
@@ -510,25 +538,17 @@ void MainWindow::setControlsEnabled(bool state)
 
 void MainWindow::delay(int msec)
 {
-    QTime expire = QTime::currentTime().addMSecs(msec);
-    while (QTime::currentTime() <= expire)
-    {
-        QCoreApplication::processEvents();
-    }
+    Waiter::sleep(msec);
 }
 
 Dut MainWindow::getDut(int no)
 {
-    for (auto & testClient : _testClientList)
-    {
-        for(auto & dut : testClient->getDuts())
-        {
-            if(dut["no"].toInt() == no)
-                return dut;
-        }
-    }
+    auto dutSlot = _dutSlots.value(no);
+
+    if (!dutSlot.first)
+        return Dut();
 
-    return dutTemplate;
+    return dutSlot.first->dut(dutSlot.second);
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
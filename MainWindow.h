@@ -12,6 +12,8 @@
 #include <QLineEdit>
 #include <QSharedPointer>
 #include <QStandardPaths>
+#include <QHash>
+#include <QPair>
 
 #include "SessionManager.h"
 #include "TestMethodManager.h"
@@ -61,6 +63,7 @@ private:
     QList<QThread*> _threads;
     QList<JLinkManager*> _JLinkList;
     QList<TestClient*> _testClientList;
+    QHash<int, QPair<TestClient*, int>> _dutSlots; // DUT number -> board and slot
 
     QStringList _operatorList;
 
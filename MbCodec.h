@@ -0,0 +1,175 @@
+#pragma once
+
+#include <initializer_list>
+
+#include <QByteArray>
+#include <QStringList>
+
+#include "SlipProtocol.h"
+#include "SlipDecoder.h"
+#include "CrcCcitt.h"
+
+// Measuring board packet codec generated from MB_COMMAND_TABLE in SlipProtocol.h.
+//
+// Each table entry becomes a command type (MbSwitchSwd, MbReadAdc24V, ...) that encodes
+// its request with a fixed-size store, range checks the arguments before anything is
+// sent and decodes the MB_GENERAL_RESULT reply (-1 when the board did not answer).
+// Commands without arguments are also SLIP encoded and CRC'd at compile time, one
+// frame per sequence number, so sending them costs neither allocation nor CRC work.
+
+// Argument kinds.
+struct MbDut
+{
+    static constexpr bool isValid(int value) {return value >= 1 && value <= 3;}
+};
+
+struct MbBool
+{
+    static constexpr bool isValid(int value) {return value == 0 || value == 1;}
+};
+
+struct MbByte
+{
+    static constexpr bool isValid(int value) {return value >= 0 && value <= 255;}
+};
+
+// One complete SLIP frame on channel 0, from END to END.
+struct MbEncodedFrame
+{
+    char data[16];
+    int size;
+};
+
+// A frame for every sequence number, indexed by it.
+struct MbEncodedFrames
+{
+    quint16 type;
+    MbEncodedFrame frames[256];
+};
+
+constexpr quint16 mbCrcOctet(quint16 crc, quint8 octet)
+{
+    crc ^= quint16(octet << 8);
+
+    for (int bit = 0; bit < 8; ++bit)
+        crc = (crc & 0x8000) ? quint16((crc << 1) ^ 0x1021) : quint16(crc << 1);
+
+    return crc;
+}
+
+constexpr void mbAppendEscaped(MbEncodedFrame &frame, quint8 octet)
+{
+    if (char(octet) == SlipDecoder::END_OCTET)
+    {
+        frame.data[frame.size++] = SlipDecoder::ESC_OCTET;
+        frame.data[frame.size++] = SlipDecoder::END_SUBS_OCTET;
+    }
+
+    else if (char(octet) == SlipDecoder::ESC_OCTET)
+    {
+        frame.data[frame.size++] = SlipDecoder::ESC_OCTET;
+        frame.data[frame.size++] = SlipDecoder::ESC_SUBS_OCTET;
+    }
+
+    else
+    {
+        frame.data[frame.size++] = char(octet);
+    }
+}
+
+// The CRC is linear, so the CRC of a frame with sequence s is the CRC of the frame with
+// sequence 0 XOR the zero-initialised CRC of s followed by the dataLen octet.
+constexpr MbEncodedFrames mbEncodeFrames(quint16 type)
+{
+    MbEncodedFrames result {};
+    quint8 frame[] = {0, quint8(type >> 8), quint8(type & 0xFF), 0, 0}; // Channel, MB_Packet_t
+    quint16 baseCrc = CRC_CCITT_INIT;
+
+    result.type = type;
+
+    for (auto octet : frame)
+        baseCrc = mbCrcOctet(baseCrc, octet);
+
+    for (int sequence = 0; sequence < 256; ++sequence)
+    {
+        auto &encoded = result.frames[sequence];
+        quint16 crc = baseCrc ^ mbCrcOctet(mbCrcOctet(0, quint8(sequence)), 0);
+
+        frame[3] = quint8(sequence);
+        encoded.data[encoded.size++] = SlipDecoder::END_OCTET;
+
+        for (auto octet : frame)
+            mbAppendEscaped(encoded, octet);
+
+        mbAppendEscaped(encoded, quint8(crc >> 8));
+        mbAppendEscaped(encoded, quint8(crc & 0xFF));
+        encoded.data[encoded.size++] = SlipDecoder::END_OCTET;
+    }
+
+    return result;
+}
+
+template <quint16 Type>
+struct MbFixedFrames
+{
+    static constexpr MbEncodedFrames table = mbEncodeFrames(Type);
+};
+
+template <quint16 Type>
+constexpr MbEncodedFrames MbFixedFrames<Type>::table;
+
+template <quint16 Type, typename Signature>
+struct MbCommand;
+
+template <quint16 Type, typename... Args>
+struct MbCommand<Type, void(Args...)>
+{
+    static constexpr quint16 type = Type;
+    static constexpr int argumentCount = sizeof...(Args);
+    static constexpr int packetSize = sizeof(MB_Packet_t) + sizeof...(Args);
+
+    template <typename... Values>
+    static bool isValid(Values... values)
+    {
+        static_assert(sizeof...(Values) == sizeof...(Args), "Wrong number of measuring board command arguments");
+
+        bool valid = true;
+
+        (void)std::initializer_list<int> {0, (valid = valid && Args::isValid(int(values)), 0)...};
+        return valid;
+    }
+
+    // The sequence number is left 0, PortManager assigns it.
+    template <typename... Values>
+    static QByteArray encode(Values... values)
+    {
+        static_assert(sizeof...(Values) == sizeof...(Args), "Wrong number of measuring board command arguments");
+
+        const char packet[packetSize] = {char(Type >> 8), char(Type & 0xFF), 0, char(sizeof...(Args)), char(values)...};
+
+        return QByteArray(packet, packetSize);
+    }
+
+    static int decode(const QStringList &response)
+    {
+        return response.isEmpty() ? -1 : response[0].toInt();
+    }
+};
+
+#define MB_DECLARE_COMMAND(name, type, args) using Mb##name = MbCommand<type, void args>;
+MB_COMMAND_TABLE(MB_DECLARE_COMMAND)
+#undef MB_DECLARE_COMMAND
+
+// Table name of a command type, e.g. "ReadAdc24V", "Batch" for MB_BATCH, or nullptr.
+inline const char *mbCommandName(quint16 type)
+{
+    switch (type)
+    {
+        case MB_BATCH: return "Batch";
+#define MB_COMMAND_NAME(name, packetType, args) case packetType: return #name;
+        MB_COMMAND_TABLE(MB_COMMAND_NAME)
+#undef MB_COMMAND_NAME
+    }
+
+    return nullptr;
+}
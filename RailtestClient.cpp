@@ -1,7 +1,5 @@
 #include "RailtestClient.h"
-
-#include <QCoreApplication>
-#include <QTime>
+#include "TrafficRecorder.h"
 
 RailtestClient::RailtestClient(QObject *parent)
     : QObject(parent)
@@ -19,6 +17,7 @@ bool RailtestClient::open(const QString &portName)
 {
     close();
     m_serial.setPortName(portName);
+    m_capturePort = TrafficRecorder::instance()->registerPort(portName, TrafficRecorder::TextPort);
     m_serial.setBaudRate(QSerialPort::Baud115200);
     m_serial.setDataBits(QSerialPort::Data8);
     m_serial.setParity(QSerialPort::NoParity);
@@ -35,6 +34,7 @@ void RailtestClient::close()
         m_serial.flush();
         m_serial.close();
         m_recvBuffer.clear();
+        m_recvOffset = 0;
     }
 }
 
@@ -45,17 +45,9 @@ bool RailtestClient::waitCommandPrompt(int timeout)
 
     m_syncCommand = "__waitCommandPrompt__";
 
-    QTime expire = QTime::currentTime().addMSecs(timeout);
-
-    m_serial.write("\r\n");
-    while (QTime::currentTime() <= expire)
-    {
-        QCoreApplication::processEvents();
-        if (m_syncCommand.isEmpty())
-            return true;
-    }
+    write("\r\n");
 
-    return false;
+    return m_waiter.wait([this]() {return m_syncCommand.isEmpty();}, timeout);
 }
 
 QVariantList RailtestClient::syncCommand(const QByteArray &cmd, const QByteArray &args, int timeout)
@@ -66,15 +58,9 @@ QVariantList RailtestClient::syncCommand(const QByteArray &cmd, const QByteArray
     m_syncCommand = cmd;
     m_syncReplies.clear();
 
-    QTime expire = QTime::currentTime().addMSecs(timeout);
-
-    m_serial.write(cmd + " " + args + "\r\n");
-    while (QTime::currentTime() <= expire)
-    {
-        QCoreApplication::processEvents();
-        if (m_syncCommand.isEmpty())
-            return m_syncReplies;
-    }
+    write(cmd + " " + args + "\r\n");
+    if (m_waiter.wait([this]() {return m_syncCommand.isEmpty();}, timeout))
+        return m_syncReplies;
 
     QVariantMap error;
 
@@ -85,70 +71,81 @@ QVariantList RailtestClient::syncCommand(const QByteArray &cmd, const QByteArray
     return m_syncReplies;
 }
 
-void RailtestClient::decodeReply(const QByteArray &reply)
+void RailtestClient::write(const QByteArray &data)
 {
-    if (reply.startsWith("{{(") && reply.endsWith("}}"))
-    {
-        int idx = reply.indexOf(")}");
-
-        if (idx == -1)
-            return;
-
-        auto name = reply.mid(3, idx - 3);
-        auto params = reply.mid(idx + 2, reply.length() - idx - 3).split('}');
-        QVariantMap decodedParams;
-
-        foreach (auto param, params)
-            if (param.startsWith('{'))
-            {
-                idx = param.indexOf(':');
-                if (idx != -1)
-                    decodedParams.insert(param.mid(1, idx - 1), param.mid(idx + 1));
-            }
+    TrafficRecorder::instance()->record(m_capturePort, TrafficRecorder::Sent, data.constData(), data.size());
+    m_serial.write(data);
+}
 
-        if (m_syncCommand == name)
-            m_syncReplies.append(decodedParams);
-        else
-            emit replyReceived(name, decodedParams);
+void RailtestClient::decodeReply(int from, int end)
+{
+    auto record = RailtestReply::parseLine(m_recvBuffer, from, end);
 
+    if (!record.isValid())
         return;
-    }
 
-    if (reply.startsWith("{{") && reply.endsWith("}}"))
+    if (!record.name().isEmpty())
     {
-        auto params = reply.mid(1, reply.length() - 2).split('}');
-        QVariantList decodedParams;
-
-        foreach (auto param, params)
-            if (param.startsWith('{'))
-                decodedParams.append(param.mid(1));
-
-        if (!m_syncCommand.isEmpty())
-            m_syncReplies.push_back(decodedParams);
+        if (QLatin1String(m_syncCommand) == record.name())
+            m_syncReplies.append(record.params());
+        else
+            emit replyReceived(QString(record.name()), record.params());
 
         return;
     }
+
+    if (!m_syncCommand.isEmpty())
+        m_syncReplies.push_back(record.values());
 }
 
 void RailtestClient::onSerialPortReadyRead() Q_DECL_NOTHROW
 {
     while (m_serial.bytesAvailable())
-        m_recvBuffer += m_serial.readAll();
+    {
+        int size = m_recvBuffer.size();
+        int available = int(m_serial.bytesAvailable());
+
+        m_recvBuffer.resize(size + available);
+
+        int received = int(qMax<qint64>(m_serial.read(m_recvBuffer.data() + size, available), 0));
 
-    int idx = m_recvBuffer.indexOf("\r\n");
+        m_recvBuffer.resize(size + received);
 
-    while (idx != -1)
+        if (received == 0)
+            break;
+
+        TrafficRecorder::instance()->record(m_capturePort, TrafficRecorder::Received, m_recvBuffer.constData() + size, received);
+    }
+
+    // Lines are taken by offset and the consumed text is dropped once at the end. The offset
+    // moves on before each line is decoded, a nested call from a reply handler goes on from there.
+    for (;;)
     {
-        auto reply = m_recvBuffer.left(idx);
+        if (m_recvBuffer.size() - m_recvOffset >= 2 && m_recvBuffer.at(m_recvOffset) == '>' && m_recvBuffer.at(m_recvOffset + 1) == ' ')
+        {
+            // The prompt, maybe followed by the echo of the next command on the same line.
+            m_recvOffset += 2;
+            m_syncCommand.clear();
+            m_waiter.wake();
+            continue;
+        }
+
+        int end = m_recvBuffer.indexOf("\r\n", m_recvOffset);
 
-        decodeReply(reply);
+        if (end == -1)
+            break;
 
-        m_recvBuffer = m_recvBuffer.mid(idx + 2);
-        idx = m_recvBuffer.indexOf("\r\n");
+        int from = m_recvOffset;
+
+        m_recvOffset = end + 2;
+        decodeReply(from, end);
     }
 
-    if (m_recvBuffer == "> ")
-        m_syncCommand.clear();
+    if (m_recvOffset > 0)
+    {
+        m_recvBuffer.remove(0, m_recvOffset);
+        m_recvOffset = 0;
+    }
 }
 
 void RailtestClient::onSerialPortErrorOccurred(QSerialPort::SerialPortError errorCode) Q_DECL_NOTHROW
@@ -4,6 +4,9 @@
 #include <QSerialPort>
 #include <QVariant>
 
+#include "RailtestReply.h"
+#include "Waiter.h"
+
 class RailtestClient : public QObject
 {
     Q_OBJECT
@@ -23,9 +26,13 @@ class RailtestClient : public QObject
         QByteArray
             m_recvBuffer,
             m_syncCommand;
+        int m_recvOffset = 0;
         QVariantList m_syncReplies;
+        Waiter m_waiter;
+        quint16 m_capturePort = 0;
 
-        void decodeReply(const QByteArray &reply);
+        void write(const QByteArray &data);
+        void decodeReply(int from, int end);
 
     private slots:
         void onSerialPortReadyRead() Q_DECL_NOTHROW;
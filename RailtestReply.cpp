@@ -0,0 +1,278 @@
+#include "RailtestReply.h"
+
+#include <cstring>
+
+static bool parseNumber(const char *p, int size, double &number) Q_DECL_NOTHROW
+{
+    const char *end = p + size;
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    if (p == end)
+        return false;
+
+    double result = 0;
+
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    {
+        quint64 value = 0;
+
+        for (p += 2; p < end; ++p)
+        {
+            int digit;
+
+            if (*p >= '0' && *p <= '9')
+                digit = *p - '0';
+            else if (*p >= 'a' && *p <= 'f')
+                digit = *p - 'a' + 10;
+            else if (*p >= 'A' && *p <= 'F')
+                digit = *p - 'A' + 10;
+            else
+                return false;
+
+            value = (value << 4) | digit;
+        }
+
+        result = double(value);
+    }
+
+    else
+    {
+        int digits = 0;
+
+        for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+            result = result * 10 + (*p - '0');
+
+        if (p < end && *p == '.')
+        {
+            double scale = 1;
+
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+            {
+                scale /= 10;
+                result += (*p - '0') * scale;
+            }
+        }
+
+        if (p != end || digits == 0)
+            return false;
+    }
+
+    number = negative ? -result : result;
+    return true;
+}
+
+QVector<RailtestReply> RailtestReply::parseAll(const QByteArray &text)
+{
+    QVector<RailtestReply> replies;
+    int pos = text.indexOf("{{");
+
+    while (pos != -1)
+    {
+        RailtestReply reply;
+
+        reply._text = text;
+
+        int next = reply.parse(pos, text.size());
+
+        if (next == -1)
+        {
+            pos = text.indexOf("{{", pos + 1);
+            continue;
+        }
+
+        replies.append(reply);
+        pos = text.indexOf("{{", next);
+    }
+
+    return replies;
+}
+
+RailtestReply RailtestReply::parseLine(const QByteArray &line)
+{
+    return parseLine(line, 0, line.size());
+}
+
+RailtestReply RailtestReply::parseLine(const QByteArray &text, int from, int end)
+{
+    RailtestReply reply;
+
+    reply._text = text;
+    if (reply.parse(from, end) != end)
+        return RailtestReply();
+
+    return reply;
+}
+
+// Parses the record at text[from], returns the offset past its closing brace or -1.
+int RailtestReply::parse(int from, int end)
+{
+    const char *text = _text.constData();
+    int pos = from;
+
+    _valid = false;
+    _nameOffset = _nameSize = 0;
+    _fields.clear();
+
+    if (pos >= end || text[pos] != '{')
+        return -1;
+
+    for (++pos; pos < end && text[pos] == '{'; )
+    {
+        int start = pos + 1;
+        auto close = static_cast<const char*>(memchr(text + start, '}', end - start));
+
+        if (!close)
+            return -1;
+
+        int size = int(close - text) - start;
+
+        if (pos == from + 1 && size >= 2 && text[start] == '(' && text[start + size - 1] == ')')
+        {
+            _nameOffset = start + 1;
+            _nameSize = size - 2;
+        }
+
+        else
+        {
+            Field field;
+            auto colon = static_cast<const char*>(memchr(text + start, ':', size));
+
+            if (colon)
+            {
+                field.keyOffset = start;
+                field.keySize = int(colon - text) - start;
+                field.valueOffset = field.keyOffset + field.keySize + 1;
+                field.valueSize = size - field.keySize - 1;
+            }
+
+            else
+            {
+                field.keyOffset = start;
+                field.keySize = 0;
+                field.valueOffset = start;
+                field.valueSize = size;
+            }
+
+            field.number = 0;
+            field.isNumber = parseNumber(text + field.valueOffset, field.valueSize, field.number);
+            _fields.append(field);
+        }
+
+        pos = start + size + 1;
+    }
+
+    if (pos >= end || text[pos] != '}')
+        return -1;
+
+    _valid = true;
+    return pos + 1;
+}
+
+QStringList RailtestReply::tokenize(const char *data, int size)
+{
+    QStringList tokens;
+    int start = -1;
+
+    for (int i = 0; i <= size; ++i)
+    {
+        bool separator = true;
+
+        if (i < size)
+        {
+            switch (data[i])
+            {
+                case '{': case '}': case '>':
+                case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
+                    break;
+                default:
+                    separator = false;
+            }
+        }
+
+        if (!separator && start == -1)
+        {
+            start = i;
+        }
+
+        else if (separator && start != -1)
+        {
+            tokens.append(QString::fromUtf8(data + start, i - start));
+            start = -1;
+        }
+    }
+
+    return tokens;
+}
+
+int RailtestReply::indexOf(QLatin1String key) const
+{
+    for (int i = 0; i < _fields.size(); ++i)
+    {
+        if (this->key(i) == key)
+            return i;
+    }
+
+    return -1;
+}
+
+QLatin1String RailtestReply::value(QLatin1String key) const
+{
+    int index = indexOf(key);
+
+    return index == -1 ? QLatin1String() : value(index);
+}
+
+double RailtestReply::number(QLatin1String key, double defaultValue) const
+{
+    int index = indexOf(key);
+
+    return (index == -1 || !_fields[index].isNumber) ? defaultValue : _fields[index].number;
+}
+
+QVariant RailtestReply::variant(int index) const
+{
+    if (_fields[index].isNumber)
+        return _fields[index].number;
+
+    return QString(value(index));
+}
+
+QVariantMap RailtestReply::params() const
+{
+    QVariantMap result;
+
+    for (int i = 0; i < _fields.size(); ++i)
+    {
+        if (_fields[i].keySize)
+            result.insert(QString(key(i)), variant(i));
+    }
+
+    return result;
+}
+
+QVariantList RailtestReply::values() const
+{
+    QVariantList result;
+
+    for (int i = 0; i < _fields.size(); ++i)
+        result.append(QString(value(i)));
+
+    return result;
+}
+
+QVariantMap RailtestReply::toVariantMap() const
+{
+    QVariantMap result;
+
+    result.insert("name", QString(name()));
+    result.insert("params", params());
+    result.insert("values", values());
+
+    return result;
+}
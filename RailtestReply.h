@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QByteArray>
+#include <QLatin1String>
+#include <QVarLengthArray>
+#include <QVector>
+#include <QVariant>
+#include <QStringList>
+
+// One railtest reply record, {{(name)}{key:value}...} or a positional {{value}{value}...}.
+//
+// The record is parsed in a single pass and keeps only offsets into the (implicitly
+// shared) reply text, so names, keys and values are views, not copies. Numeric values
+// (decimal, fractional or 0x hex) are converted once while parsing.
+
+class RailtestReply
+{
+public:
+
+    RailtestReply() = default;
+
+    // All records found in a raw reply, e.g. the command echo, the records and the prompt.
+    static QVector<RailtestReply> parseAll(const QByteArray &text);
+
+    // The line has to be exactly one record, otherwise the result is invalid.
+    static RailtestReply parseLine(const QByteArray &line);
+
+    // The same for text[from, end), the record shares text instead of copying the line.
+    static RailtestReply parseLine(const QByteArray &text, int from, int end);
+
+    // The legacy word list: braces, line breaks and the prompt taken as separators.
+    static QStringList tokenize(const char *data, int size);
+
+    bool isValid() const {return _valid;}
+    QLatin1String name() const {return view(_nameOffset, _nameSize);}
+
+    int count() const {return _fields.size();}
+    QLatin1String key(int index) const {return view(_fields[index].keyOffset, _fields[index].keySize);}
+    QLatin1String value(int index) const {return view(_fields[index].valueOffset, _fields[index].valueSize);}
+    bool isNumber(int index) const {return _fields[index].isNumber;}
+    double number(int index) const {return _fields[index].number;}
+
+    int indexOf(QLatin1String key) const;
+    bool contains(QLatin1String key) const {return indexOf(key) != -1;}
+    QLatin1String value(QLatin1String key) const;
+    double number(QLatin1String key, double defaultValue = 0) const;
+
+    // key -> number or string, values in the order received as strings.
+    QVariantMap params() const;
+    QVariantList values() const;
+
+    // {name, params, values}, the form handed to the scripts.
+    QVariantMap toVariantMap() const;
+
+private:
+
+    struct Field
+    {
+        int keyOffset;
+        int keySize;
+        int valueOffset;
+        int valueSize;
+        bool isNumber;
+        double number;
+    };
+
+    int parse(int from, int end);
+    QLatin1String view(int offset, int size) const {return QLatin1String(_text.constData() + offset, size);}
+    QVariant variant(int index) const;
+
+    QByteArray _text;
+    bool _valid = false;
+    int _nameOffset = 0;
+    int _nameSize = 0;
+    QVarLengthArray<Field, 16> _fields;
+};
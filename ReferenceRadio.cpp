@@ -0,0 +1,218 @@
+#include "ReferenceRadio.h"
+
+#include <QCoreApplication>
+
+#include "SerialPortRegistry.h"
+#include "Waiter.h"
+
+static constexpr int RESET_TIMEOUT = 2000;
+static constexpr int COMMAND_TIMEOUT = 500;
+
+static QHash<QString, ReferenceRadio*> &sessions()
+{
+    static QHash<QString, ReferenceRadio*> radios;
+
+    return radios;
+}
+
+ReferenceRadio *ReferenceRadio::instance(const QString &moduleId)
+{
+    auto &radio = sessions()[moduleId];
+
+    if (!radio)
+        radio = new ReferenceRadio(moduleId, qApp);
+
+    return radio;
+}
+
+void ReferenceRadio::closeAll()
+{
+    for (auto & radio : sessions())
+        radio->close();
+}
+
+ReferenceRadio::ReferenceRadio(const QString &moduleId, QObject *parent) : QObject(parent), _moduleId(moduleId)
+{
+    connect(&_rf, &RailtestClient::replyReceived, this, &ReferenceRadio::replyReceived);
+    connect(&_rf, &RailtestClient::replyReceived, this, &ReferenceRadio::onReplyReceived);
+    connect(&_rf, &RailtestClient::error, this, &ReferenceRadio::fail);
+    connect(SerialPortRegistry::instance(), &SerialPortRegistry::portRemoved, this, [this](QString serialNumber)
+    {
+        if (serialNumber == _moduleId)
+            fail("Reference radio module has been unplugged.");
+    });
+}
+
+bool ReferenceRadio::ready()
+{
+    if (_open)
+        return true;
+
+    auto portName = SerialPortRegistry::instance()->portName(_moduleId);
+
+    if (portName.isEmpty() || !_rf.open(portName))
+    {
+        fail("Cannot open serial port for reference radio module.");
+        return false;
+    }
+
+    _rf.syncCommand("reset", "", RESET_TIMEOUT);
+
+    if (!_rf.waitCommandPrompt())
+    {
+        fail("Timeout waiting reference radio module command prompt.");
+        return false;
+    }
+
+    // Whatever the module ran before the reset, the session starts from its defaults.
+    _open = true;
+    _receiving = true;
+    _settings.clear();
+
+    return setReceiving(false);
+}
+
+void ReferenceRadio::close()
+{
+    _rf.close();
+    _open = false;
+    _settings.clear();
+}
+
+bool ReferenceRadio::listen(const Settings &settings)
+{
+    if (configure(settings) && setReceiving(true))
+        return true;
+
+    // A dropped link closed the session, one more attempt reopens and resets the module.
+    if (_open)
+        return false;
+
+    return configure(settings) && setReceiving(true);
+}
+
+bool ReferenceRadio::listenBle(int channel)
+{
+    return listen({{"setBleMode", "1"}, {"setBle1Mbps", "1"}, {"setChannel", QByteArray::number(channel)}});
+}
+
+void ReferenceRadio::startCapture(int markerOffset)
+{
+    _markerOffset = markerOffset;
+    _captured.clear();
+    _capturing = true;
+    _captureTimer.start();
+}
+
+void ReferenceRadio::waitUntil(int msecs)
+{
+    Waiter::sleep(int(msecs - _captureTimer.elapsed()));
+}
+
+QVariantMap ReferenceRadio::finishCapture()
+{
+    QVariantMap result;
+
+    for (auto it = _captured.begin(); it != _captured.end(); ++it)
+        result.insert(QString::number(it.key()), it.value().toVariantMap());
+
+    _capturing = false;
+    _captured.clear();
+
+    return result;
+}
+
+void ReferenceRadio::expectTraffic(int msecs)
+{
+    if (msecs > _quiet.remainingTime())
+        _quiet.setRemainingTime(msecs, Qt::PreciseTimer);
+}
+
+void ReferenceRadio::waitQuiet()
+{
+    Waiter::sleep(int(_quiet.remainingTime()));
+}
+
+bool ReferenceRadio::configure(const Settings &settings)
+{
+    if (!ready())
+        return false;
+
+    Settings changes;
+
+    for (auto & setting : settings)
+    {
+        auto current = _settings.find(setting.first);
+
+        if (current == _settings.end() || current.value() != setting.second)
+            changes.append(setting);
+    }
+
+    if (changes.isEmpty())
+        return true;
+
+    if (!setReceiving(false))
+        return false;
+
+    for (auto & change : changes)
+    {
+        if (!command(change.first, change.second))
+            return false;
+
+        _settings.insert(change.first, change.second);
+    }
+
+    return true;
+}
+
+bool ReferenceRadio::setReceiving(bool on)
+{
+    if (!ready())
+        return false;
+
+    if (_receiving == on)
+        return true;
+
+    if (!command("rx", on ? "1" : "0"))
+        return false;
+
+    _receiving = on;
+    return true;
+}
+
+bool ReferenceRadio::command(const QByteArray &cmd, const QByteArray &args)
+{
+    for (auto & reply : _rf.syncCommand(cmd, args, COMMAND_TIMEOUT))
+    {
+        if (reply.toMap().value("error").toString() == "timeout")
+        {
+            fail(QString("Reference radio module did not answer %1 %2.").arg(QString(cmd)).arg(QString(args)));
+            return false;
+        }
+    }
+
+    return _open;
+}
+
+void ReferenceRadio::fail(const QString &error)
+{
+    // The port is closed and the module reset by the next ready().
+    _lastError = error;
+    _open = false;
+    _settings.clear();
+}
+
+void ReferenceRadio::onReplyReceived(const QString &id, const QVariantMap &params)
+{
+    if (!_capturing || id != "rxPacket" || !params.contains("rssi"))
+        return;
+
+    // payload: 0x0f 0x16 ..., the marker is one of its octets.
+    auto payload = params.value("payload").toString().split(' ', Qt::SkipEmptyParts);
+    bool markerOk, rssiOk;
+    int marker = payload.value(_markerOffset).toInt(&markerOk, 0);
+    int rssi = params.value("rssi").toInt(&rssiOk);
+
+    if (markerOk && rssiOk)
+        _captured[marker].add(rssi);
+}
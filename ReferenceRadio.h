@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QElapsedTimer>
+#include <QDeadlineTimer>
+
+#include "RailtestClient.h"
+#include "RunningStats.h"
+
+// Long-lived session with a reference radio module running railtest.
+//
+// The module is opened and reset once, then kept open across DUTs. The session remembers
+// the settings it has applied, so configure() only sends the commands whose arguments
+// differ. A lost link (serial error, unplugged module, command timeout) closes the
+// session; the next ready() reopens and resets the module and forgets the settings.
+// One session per module serial number, used from the thread running the test sequences.
+//
+// For testing several DUTs at once the session captures received packets per source: each
+// DUT puts its own marker octet into its payload and the RSSI statistics are kept per marker.
+
+class ReferenceRadio : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    typedef QVector<QPair<QByteArray, QByteArray>> Settings;
+
+    static ReferenceRadio *instance(const QString &moduleId);
+
+    // Closes every session, e.g. when a test session ends.
+    static void closeAll();
+
+    // Applies the settings that differ from the current ones, with the receiver off while
+    // doing so, then turns the receiver on. Reopens the module once if the link was lost.
+    bool listen(const Settings &settings);
+
+public slots:
+
+    // Opens and resets the module unless the session is up already.
+    bool ready();
+    void close();
+
+    // listen() on a BLE 1 Mbps channel.
+    bool listenBle(int channel);
+
+    // Counts received packets per payload octet at markerOffset from now on.
+    void startCapture(int markerOffset);
+
+    // Sleeps until msecs after startCapture(), packets keep coming in meanwhile.
+    void waitUntil(int msecs);
+
+    // Ends the capture, returns {marker: {count, min, max, mean, stddev}} of the RSSI values.
+    QVariantMap finishCapture();
+
+    // A DUT keeps transmitting for msecs after its test was decided; waitQuiet() waits that out.
+    void expectTraffic(int msecs);
+    void waitQuiet();
+
+    QString lastError() const {return _lastError;}
+
+signals:
+
+    void replyReceived(QString id, QVariantMap params);
+
+private:
+
+    explicit ReferenceRadio(const QString &moduleId, QObject *parent = nullptr);
+
+    bool configure(const Settings &settings);
+    bool setReceiving(bool on);
+
+    // False when the module did not answer in time, the session is closed then.
+    bool command(const QByteArray &cmd, const QByteArray &args);
+    void fail(const QString &error);
+    void onReplyReceived(const QString &id, const QVariantMap &params);
+
+    QString _moduleId;
+    QString _lastError;
+    RailtestClient _rf;
+    bool _open = false;
+    bool _receiving = false;
+    QHash<QByteArray, QByteArray> _settings;
+
+    bool _capturing = false;
+    int _markerOffset = 0;
+    QElapsedTimer _captureTimer;
+    QHash<int, RunningStats> _captured;
+
+    QDeadlineTimer _quiet;
+};
@@ -0,0 +1,41 @@
+#include "RunningStats.h"
+
+#include <cmath>
+
+void RunningStats::add(double value) Q_DECL_NOTHROW
+{
+    if (!_count || value < _min)
+        _min = value;
+    if (!_count || value > _max)
+        _max = value;
+
+    ++_count;
+
+    double delta = value - _mean;
+
+    _mean += delta / _count;
+    _m2 += delta * (value - _mean);
+}
+
+void RunningStats::reset() Q_DECL_NOTHROW
+{
+    *this = RunningStats();
+}
+
+double RunningStats::stddev() const
+{
+    return std::sqrt(variance());
+}
+
+QVariantMap RunningStats::toVariantMap() const
+{
+    QVariantMap result;
+
+    result.insert("count", _count);
+    result.insert("min", min());
+    result.insert("max", max());
+    result.insert("mean", _mean);
+    result.insert("stddev", stddev());
+
+    return result;
+}
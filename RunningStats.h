@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QVariantMap>
+
+// Count, extremes, mean and standard deviation of a sample stream.
+//
+// The mean and the variance are updated with Welford's method, which stays exact for
+// long runs of large raw ADC values where summing squares would lose precision. Adding
+// a sample is a few floating point operations and never allocates.
+
+class RunningStats
+{
+public:
+
+    void add(double value) Q_DECL_NOTHROW;
+    void reset() Q_DECL_NOTHROW;
+
+    quint64 count() const {return _count;}
+    double min() const {return _count ? _min : 0;}
+    double max() const {return _count ? _max : 0;}
+    double mean() const {return _mean;}
+
+    // Sample variance and standard deviation, 0 below two samples.
+    double variance() const {return _count > 1 ? _m2 / (_count - 1) : 0;}
+    double stddev() const;
+
+    // count, min, max, mean and stddev.
+    QVariantMap toVariantMap() const;
+
+private:
+
+    quint64 _count = 0;
+    double _min = 0;
+    double _max = 0;
+    double _mean = 0;
+    double _m2 = 0;
+};
@@ -0,0 +1,120 @@
+#include "SerialPortRegistry.h"
+
+#include <QCoreApplication>
+#include <QFileSystemWatcher>
+#include <QSerialPortInfo>
+#include <QDir>
+
+#ifdef Q_OS_WIN
+    #include <windows.h>
+    #include <dbt.h>
+#endif
+
+static constexpr int REFRESH_DELAY = 300;
+
+SerialPortRegistry *SerialPortRegistry::instance()
+{
+    static SerialPortRegistry *registry = new SerialPortRegistry(qApp);
+
+    return registry;
+}
+
+SerialPortRegistry::SerialPortRegistry(QObject *parent) : QObject(parent)
+{
+    _refreshTimer.setSingleShot(true);
+    _refreshTimer.setInterval(REFRESH_DELAY);
+    connect(&_refreshTimer, &QTimer::timeout, this, &SerialPortRegistry::refresh);
+
+#ifdef Q_OS_WIN
+    qApp->installNativeEventFilter(this);
+#else
+    // udev maintains one link per USB serial adapter here, the directory changes on every plug.
+    _watcher = new QFileSystemWatcher(this);
+    _watcher->addPath("/dev");
+    if (QDir("/dev/serial/by-id").exists())
+        _watcher->addPath("/dev/serial/by-id");
+
+    connect(_watcher, &QFileSystemWatcher::directoryChanged, this, [this]()
+    {
+        if (QDir("/dev/serial/by-id").exists() && !_watcher->directories().contains("/dev/serial/by-id"))
+            _watcher->addPath("/dev/serial/by-id");
+
+        _refreshTimer.start();
+    });
+#endif
+
+    refresh();
+}
+
+SerialPortRegistry::~SerialPortRegistry()
+{
+#ifdef Q_OS_WIN
+    qApp->removeNativeEventFilter(this);
+#endif
+}
+
+QString SerialPortRegistry::portName(const QString &serialNumber) const
+{
+    QReadLocker locker(&_lock);
+
+    return _ports.value(serialNumber);
+}
+
+QStringList SerialPortRegistry::serialNumbers() const
+{
+    QReadLocker locker(&_lock);
+
+    return _ports.keys();
+}
+
+void SerialPortRegistry::refresh()
+{
+    QHash<QString, QString> ports;
+
+    for (auto & portInfo : QSerialPortInfo::availablePorts())
+    {
+        if (!portInfo.serialNumber().isEmpty())
+            ports.insert(portInfo.serialNumber(), portInfo.portName());
+    }
+
+    QHash<QString, QString> previous;
+
+    {
+        QWriteLocker locker(&_lock);
+
+        previous = _ports;
+        _ports = ports;
+    }
+
+    for (auto it = previous.begin(); it != previous.end(); ++it)
+    {
+        if (ports.value(it.key()) != it.value())
+            emit portRemoved(it.key(), it.value());
+    }
+
+    for (auto it = ports.begin(); it != ports.end(); ++it)
+    {
+        if (previous.value(it.key()) != it.value())
+            emit portAdded(it.key(), it.value());
+    }
+}
+
+bool SerialPortRegistry::nativeEventFilter(const QByteArray &eventType, void *message, long *result)
+{
+    Q_UNUSED(result);
+
+#ifdef Q_OS_WIN
+    if (eventType == "windows_generic_MSG")
+    {
+        auto msg = static_cast<MSG*>(message);
+
+        if (msg->message == WM_DEVICECHANGE && (msg->wParam == DBT_DEVICEARRIVAL || msg->wParam == DBT_DEVICEREMOVECOMPLETE))
+            _refreshTimer.start();
+    }
+#else
+    Q_UNUSED(eventType);
+    Q_UNUSED(message);
+#endif
+
+    return false;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QObject>
+#include <QAbstractNativeEventFilter>
+#include <QReadWriteLock>
+#include <QHash>
+#include <QTimer>
+
+class QFileSystemWatcher;
+
+// Process-wide cache of the serial ports, keyed by the USB serial number.
+//
+// The ports are enumerated once and again only after a hot-plug event (WM_DEVICECHANGE
+// on Windows, udev changing /dev/serial/by-id on Linux), so lookups never touch the
+// system. Lookups are thread safe; the registry itself lives in the main thread and
+// must be created there first.
+
+class SerialPortRegistry : public QObject, public QAbstractNativeEventFilter
+{
+    Q_OBJECT
+
+public:
+
+    static SerialPortRegistry *instance();
+
+    // Empty when no port has that serial number.
+    QString portName(const QString &serialNumber) const;
+    QStringList serialNumbers() const;
+
+    bool nativeEventFilter(const QByteArray &eventType, void *message, long *result) override;
+
+public slots:
+
+    void refresh();
+
+signals:
+
+    void portAdded(QString serialNumber, QString portName);
+    void portRemoved(QString serialNumber, QString portName);
+
+private:
+
+    explicit SerialPortRegistry(QObject *parent = nullptr);
+    ~SerialPortRegistry();
+
+    mutable QReadWriteLock _lock;
+    QHash<QString, QString> _ports;
+
+    // Hot-plug events come in bursts, one enumeration follows the last of them.
+    QTimer _refreshTimer;
+    QFileSystemWatcher *_watcher = nullptr;
+};
@@ -0,0 +1,122 @@
+#include "SerialWorker.h"
+#include "TrafficRecorder.h"
+
+SerialWorker::SerialWorker(QObject *parent) : QObject(parent), _serial(this)
+{
+    connect(&_serial, &QSerialPort::readyRead, this, &SerialWorker::onSerialPortReadyRead);
+    connect(&_serial, &QSerialPort::errorOccurred, this, &SerialWorker::onSerialPortErrorOccurred);
+
+    _decoder.setFrameHandler([this](quint8 channel, const char *payload, int size)
+    {
+        SlipFrame frame;
+
+        frame.channel = channel;
+        frame.payload = QByteArray(payload, size);
+
+        if (!_rxQueue.push(frame))
+        {
+            emit errorOccurred(QString("Receive queue overflow on port %1, frame dropped.").arg(_serial.portName()));
+            return;
+        }
+
+        if (!_rxNotified.exchange(true))
+            emit framesReceived();
+    });
+    _decoder.setErrorHandler([this](SlipDecoder::Error error)
+    {
+        emit errorOccurred(QString("SLIP. Decode frame. %1").arg(SlipDecoder::errorString(error)));
+    });
+}
+
+bool SerialWorker::send(const QByteArray &data)
+{
+    if (!_txQueue.push(data))
+        return false;
+
+    if (!_txNotified.exchange(true))
+        QMetaObject::invokeMethod(this, "writePending", Qt::QueuedConnection);
+
+    return true;
+}
+
+void SerialWorker::takeFrames(const std::function<void(const SlipFrame &)> &handler)
+{
+    // Cleared before draining, so a frame pushed meanwhile posts a new notification.
+    _rxNotified = false;
+
+    SlipFrame frame;
+
+    while (_rxQueue.pop(frame))
+        handler(frame);
+}
+
+bool SerialWorker::open(const QString &name, int baudRate, int dataBits, int parity, int stopBits, int flowControl)
+{
+    if (_serial.isOpen())
+        _serial.close();
+
+    _serial.setPortName(name);
+    _capturePort = TrafficRecorder::instance()->registerPort(name, TrafficRecorder::SlipPort);
+
+    bool res = _serial.setBaudRate(baudRate)
+        && _serial.setDataBits(QSerialPort::DataBits(dataBits))
+        && _serial.setParity(QSerialPort::Parity(parity))
+        && _serial.setStopBits(QSerialPort::StopBits(stopBits))
+        && _serial.setFlowControl(QSerialPort::FlowControl(flowControl));
+
+    if (!res)
+        emit errorOccurred(_serial.errorString());
+
+    if (!_serial.open(QSerialPort::ReadWrite))
+    {
+        emit errorOccurred("an error occures when opening serial port: " + _serial.errorString());
+        return false;
+    }
+
+    _serial.clear(QSerialPort::Input);
+    _decoder.reset();
+    return true;
+}
+
+void SerialWorker::close()
+{
+    if (_serial.isOpen())
+    {
+        writePending();
+        _serial.flush();
+        _serial.close();
+    }
+}
+
+void SerialWorker::writePending()
+{
+    _txNotified = false;
+
+    QByteArray data;
+
+    while (_txQueue.pop(data))
+    {
+        if (_serial.isOpen())
+        {
+            TrafficRecorder::instance()->record(_capturePort, TrafficRecorder::Sent, data.constData(), data.size());
+            _serial.write(data);
+        }
+    }
+}
+
+void SerialWorker::onSerialPortReadyRead()
+{
+    qint64 size;
+
+    while ((size = _serial.read(_readChunk, sizeof(_readChunk))) > 0)
+    {
+        TrafficRecorder::instance()->record(_capturePort, TrafficRecorder::Received, _readChunk, int(size));
+        _decoder.feed(_readChunk, int(size));
+    }
+}
+
+void SerialWorker::onSerialPortErrorOccurred(QSerialPort::SerialPortError errorCode)
+{
+    if (errorCode != QSerialPort::NoError)
+        emit errorOccurred("Serial port error occurred " + QString().setNum(errorCode) + " on port " + _serial.portName());
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#include <QSerialPort>
+
+#include "SlipDecoder.h"
+#include "SpscQueue.h"
+
+struct SlipFrame
+{
+    quint8 channel = 0;
+    QByteArray payload;
+};
+
+// Drives one serial port from a dedicated I/O thread.
+//
+// The owner thread hands encoded frames in through one lock-free queue and takes
+// decoded SLIP frames out of another, so the port is read and decoded as soon as
+// data arrives, whatever the owner thread is busy with. Each queue has exactly one
+// producer and one consumer; a queued notification is posted only when a queue
+// goes from idle to non-empty.
+
+class SerialWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit SerialWorker(QObject *parent = nullptr);
+
+    // Owner thread side.
+    bool send(const QByteArray &data);
+    void takeFrames(const std::function<void(const SlipFrame &frame)> &handler);
+
+public slots:
+
+    // Run in the I/O thread, invoked through a blocking queued connection.
+    bool open(const QString &name, int baudRate, int dataBits, int parity, int stopBits, int flowControl);
+    void close();
+
+signals:
+
+    void framesReceived();
+    void errorOccurred(QString message);
+
+private slots:
+
+    void writePending();
+    void onSerialPortReadyRead();
+    void onSerialPortErrorOccurred(QSerialPort::SerialPortError errorCode);
+
+private:
+
+    QSerialPort _serial;
+    SlipDecoder _decoder;
+    char _readChunk[512];
+    quint16 _capturePort = 0;
+
+    SpscQueue<QByteArray, 256> _txQueue;
+    SpscQueue<SlipFrame, 1024> _rxQueue;
+    std::atomic<bool> _txNotified {false};
+    std::atomic<bool> _rxNotified {false};
+};
@@ -39,15 +39,15 @@ void SessionManager::logDutInfo(Dut dut)
 
     record.runningNumber = zeroFields + QString().setNum(_runningNumber);
 
-    record.id = dut["id"].toString();
-    record.no = dut["no"].toString();
-    record.error = dut["error"].toString().remove('\n').remove('\r').remove(';').remove(',');
+    record.id = dut.id;
+    record.no = QString::number(dut.no);
+    record.error = QString(dut.error).remove('\n').remove('\r').remove(';').remove(',');
     record.batchNumber = _batchNumber;
     record.method = _method;
     record.operatorName = _operatorName;
     record.timeStamp = _startTime;
 
-    if(dut["state"].toInt() != DutState::tested)
+    if(dut.state != DutState::tested)
     {
         _failedCount++;
         record.state = "FAILED";
@@ -0,0 +1,149 @@
+#include "SlipDecoder.h"
+#include "CrcCcitt.h"
+
+constexpr char
+    SlipDecoder::END_OCTET,
+    SlipDecoder::END_SUBS_OCTET,
+    SlipDecoder::ESC_OCTET,
+    SlipDecoder::ESC_SUBS_OCTET;
+
+constexpr int
+    SlipDecoder::MIN_FRAME_SIZE,
+    SlipDecoder::DEFAULT_MAX_FRAME_SIZE;
+
+SlipDecoder::SlipDecoder(int maxFrameSize) : _buffer(qMax(maxFrameSize, MIN_FRAME_SIZE))
+{
+}
+
+void SlipDecoder::reset() Q_DECL_NOTHROW
+{
+    _state = waitStart;
+    _size = 0;
+}
+
+void SlipDecoder::feed(const char *data, int size) Q_DECL_NOTHROW
+{
+    const char *end = data + size;
+    char *buffer = _buffer.data();
+    const int capacity = _buffer.size();
+
+    for (const char *p = data; p != end; ++p)
+    {
+        char ch = *p;
+
+        if (ch == END_OCTET)
+        {
+            // END closes a started frame, bytes up to the next END are line noise.
+            // Back to back END octets delimit an empty frame and just open a new one.
+            if (_state != waitStart && _size > 0)
+            {
+                if (_state != discardFrame)
+                    finishFrame();
+
+                _state = waitStart;
+            }
+            else
+                _state = inFrame;
+
+            _size = 0;
+            continue;
+        }
+
+        switch (_state)
+        {
+            case waitStart:
+            case discardFrame:
+                continue;
+
+            case inEscape:
+                if (ch == END_SUBS_OCTET)
+                    ch = END_OCTET;
+                else if (ch == ESC_SUBS_OCTET)
+                    ch = ESC_OCTET;
+                else
+                {
+                    reportError(InvalidEscape);
+                    _state = discardFrame;
+                    continue;
+                }
+                _state = inFrame;
+                break;
+
+            case inFrame:
+                if (ch == ESC_OCTET)
+                {
+                    _state = inEscape;
+                    continue;
+                }
+                break;
+        }
+
+        if (_size == capacity)
+        {
+            reportError(FrameTooLong);
+            _state = discardFrame;
+            continue;
+        }
+
+        buffer[_size++] = ch;
+    }
+}
+
+void SlipDecoder::finishFrame() Q_DECL_NOTHROW
+{
+    if (_state == inEscape)
+    {
+        reportError(InvalidEscape);
+        return;
+    }
+
+    if (_size < MIN_FRAME_SIZE)
+    {
+        reportError(FrameTooShort);
+        return;
+    }
+
+    // Running the CRC over the frame including its big endian CRC leaves a zero residue.
+    // The whole frame is still in cache here, so one block CRC beats a per byte update.
+    if (crcCcitt(CRC_CCITT_INIT, _buffer.constData(), _size) != 0)
+    {
+        reportError(InvalidCrc);
+        return;
+    }
+
+    ++_framesDecoded;
+
+    if (_frameHandler)
+        _frameHandler(quint8(_buffer.at(0)), _buffer.constData() + 1, _size - 3);
+}
+
+void SlipDecoder::reportError(Error error) Q_DECL_NOTHROW
+{
+    ++_errorCount;
+
+    if (_errorHandler)
+        _errorHandler(error);
+}
+
+const char *SlipDecoder::errorString(Error error)
+{
+    switch (error)
+    {
+        case NoError:
+            return "No error.";
+
+        case InvalidEscape:
+            return "Invalid escape sequence.";
+
+        case FrameTooShort:
+            return "Frame too short.";
+
+        case FrameTooLong:
+            return "Frame too long.";
+
+        case InvalidCrc:
+            return "Invalid Frame CRC.";
+    }
+
+    return "Unknown error.";
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+
+#include <QtGlobal>
+#include <QVector>
+
+// Streaming SLIP frame decoder.
+//
+// Bytes are unescaped into one preallocated frame buffer, so feeding data never
+// allocates. A frame is [channel][payload][CRC16 big endian] between END octets;
+// complete frames are CRC checked and handed out as views into the decoder buffer.
+
+class SlipDecoder
+{
+public:
+
+    enum Error {NoError, InvalidEscape, FrameTooShort, FrameTooLong, InvalidCrc};
+
+    // The payload points into the decoder buffer and is valid only until the handler returns.
+    using FrameHandler = std::function<void(quint8 channel, const char *payload, int size)>;
+    using ErrorHandler = std::function<void(SlipDecoder::Error error)>;
+
+    static constexpr char
+        END_OCTET = char(0xC0),
+        END_SUBS_OCTET = char(0xDC),
+        ESC_OCTET = char(0xDB),
+        ESC_SUBS_OCTET = char(0xDD);
+
+    static constexpr int MIN_FRAME_SIZE = sizeof(quint8) + sizeof(quint16) + 1;
+    static constexpr int DEFAULT_MAX_FRAME_SIZE = 4096;
+
+    explicit SlipDecoder(int maxFrameSize = DEFAULT_MAX_FRAME_SIZE);
+
+    void setFrameHandler(const FrameHandler &handler) {_frameHandler = handler;}
+    void setErrorHandler(const ErrorHandler &handler) {_errorHandler = handler;}
+
+    void feed(const char *data, int size) Q_DECL_NOTHROW;
+    void reset() Q_DECL_NOTHROW;
+
+    quint64 framesDecoded() const {return _framesDecoded;}
+    quint64 errorCount() const {return _errorCount;}
+
+    static const char *errorString(Error error);
+
+private:
+
+    enum State {waitStart, inFrame, inEscape, discardFrame};
+
+    void finishFrame() Q_DECL_NOTHROW;
+    void reportError(Error error) Q_DECL_NOTHROW;
+
+    FrameHandler _frameHandler;
+    ErrorHandler _errorHandler;
+
+    State _state = waitStart;
+    QVector<char> _buffer;
+    int _size = 0;
+
+    quint64 _framesDecoded = 0;
+    quint64 _errorCount = 0;
+};
@@ -18,13 +18,38 @@ enum {
   MB_READ_ADC_24V                    = 12,                 // RET - raw value or error
   MB_READ_ADC_3V                     = 13,                 // RET - raw value or error
   MB_READ_ADC_TEMP                   = 14,                 // RET - raw value or error
+  MB_BATCH                           = 15,                 // data - MB_Packet_t requests back to back (sequence ignored), RES - MB_BATCH_RESULT
 };
 
+enum {
+  MB_BATCH_MAX_COMMANDS              = 63,                 // One int32_t result each must fit the 255 octets of MB_BATCH_RESULT data
+};
+
+// Measuring board request table: X(name, packet type, (argument kinds)).
+// Every argument is one octet; the kinds (MbDut, MbBool, MbByte) define the valid range.
+// MbCodec.h generates the request encoding, reply decoding and argument checks from it.
+// MB_SYSTEM_RESET is answered by MB_STARTUP and MB_BATCH wraps table requests, neither is part of the table.
+#define MB_COMMAND_TABLE(X) \
+  X(SwitchSwd,                       MB_SWITCH_SWD,        (MbDut)) \
+  X(SwitchPower,                     MB_SWITCH_POWER,      (MbDut, MbBool)) \
+  X(ReadDin,                         MB_READ_DIN,          (MbDut, MbByte)) \
+  X(WriteDout,                       MB_WRITE_DOUT,        (MbDut, MbByte, MbBool)) \
+  X(ReadCsa,                         MB_READ_CSA,          (MbByte)) \
+  X(ReadAnalog,                      MB_READ_ANALOG,       (MbDut, MbByte, MbByte)) \
+  X(SwitchDali,                      MB_SWITCH_DALI,       (MbBool)) \
+  X(ReadDaliAdc,                     MB_READ_DALI_ADC,     ()) \
+  X(ReadDinAdc,                      MB_READ_DIN_ADC,      (MbDut, MbByte)) \
+  X(ReadAdc24V,                      MB_READ_ADC_24V,      ()) \
+  X(ReadAdc3V,                       MB_READ_ADC_3V,       ()) \
+  X(ReadAdcTemp,                     MB_READ_ADC_TEMP,     ())
+
 enum {
   MB_STARTUP                         = 0x8000,             // On start-up and after MB_SYSTEM_RESET
   MB_ASYNC_EVENT                     = 0x8001,
   MB_GENERAL_RESULT                  = 0x8002,             // MB_SWITCH_SWD, MB_SWITCH_POWER, MB_READ_DIN, MB_WRITE_DOUT, MB_READ_CSA, MB_READ_ANALOG, MB_CONFIG_DUT_DEBUG,
                                                            // MB_SWITCH_DALI, MB_READ_DALI_ADC, MB_READ_DIN_ADC, MB_READ_ADC_24V, MB_READ_ADC_3V, MB_READ_ADC_TEMP
+  MB_BATCH_RESULT                    = 0x8003,             // MB_BATCH: data - int32_t result per request, in request order.
+                                                           // Firmware without batch support answers MB_GENERAL_RESULT with MB_ERROR_INVALID_PACKET_TYPE.
 };
 
 enum {
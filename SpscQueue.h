@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Bounded lock-free single-producer/single-consumer ring buffer.
+//
+// Exactly one thread may push and exactly one other thread may pop. Capacity must
+// be a power of two; one slot is kept free to tell a full queue from an empty one.
+
+template <typename T, unsigned Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+
+    bool push(T value)
+    {
+        const unsigned tail = _tail.load(std::memory_order_relaxed);
+        const unsigned next = (tail + 1) & (Capacity - 1);
+
+        if (next == _head.load(std::memory_order_acquire))
+            return false;
+
+        _items[tail] = std::move(value);
+        _tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        const unsigned head = _head.load(std::memory_order_relaxed);
+
+        if (head == _tail.load(std::memory_order_acquire))
+            return false;
+
+        value = std::move(_items[head]);
+        _items[head] = T();
+        _head.store((head + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+private:
+
+    T _items[Capacity];
+
+    // Keeps the consumer and producer indices on separate cache lines.
+    std::atomic<unsigned> _head {0};
+    char _padding[64 - sizeof(std::atomic<unsigned>)];
+    std::atomic<unsigned> _tail {0};
+};
@@ -0,0 +1,297 @@
+#include "TaskScheduler.h"
+
+#include <QTimer>
+#include <algorithm>
+#include <QMetaMethod>
+
+// Key of the awaitable descriptors yield hands back to the scheduler.
+static const char AWAIT_KEY[] = "__await";
+
+TaskScheduler::TaskScheduler(QJSEngine *engine, QObject *parent) : QObject(parent), _engine(engine)
+{
+}
+
+int TaskScheduler::spawn(const QJSValue &generatorFunction, const QJSValue &args)
+{
+    QJSValueList argList;
+
+    for (int i = 0; i < args.property("length").toInt(); i++)
+        argList.append(args.property(quint32(i)));
+
+    int id = _nextId++;
+    auto &task = _tasks[id];
+
+    // A generator object is taken as it is, a generator function is called to make one.
+    task.generator = generatorFunction.isCallable() ? generatorFunction.call(argList) : generatorFunction;
+
+    if (task.generator.isError() || !task.generator.property("next").isCallable())
+    {
+        if (_logger)
+            _logger->logError(QString("Cannot start the task: %1").arg(task.generator.toString()));
+
+        finish(id, QJSValue());
+        return id;
+    }
+
+    resumeWait(id, task.wait, QJSValue());
+    return id;
+}
+
+QJSValue TaskScheduler::join(const QJSValue &tasks)
+{
+    auto ids = taskIds(tasks);
+    auto finished = [this, &ids]()
+    {
+        for (auto id : ids)
+        {
+            if (!isFinished(id))
+                return false;
+        }
+        return true;
+    };
+
+    _waiter.wait(finished, -1);
+
+    auto values = results(ids);
+
+    for (auto id : ids)
+        _tasks.remove(id);
+
+    return values;
+}
+
+void TaskScheduler::dropFinished()
+{
+    auto it = _tasks.begin();
+
+    while (it != _tasks.end())
+    {
+        if (it.value().finished)
+            it = _tasks.erase(it);
+        else
+            ++it;
+    }
+}
+
+QJSValue TaskScheduler::after(int msecs)
+{
+    auto awaitable = _engine->newObject();
+
+    awaitable.setProperty(AWAIT_KEY, "after");
+    awaitable.setProperty("msecs", msecs);
+
+    return awaitable;
+}
+
+QJSValue TaskScheduler::signal(QObject *sender, const QString &signature, int timeout)
+{
+    auto awaitable = _engine->newObject();
+
+    awaitable.setProperty(AWAIT_KEY, "signal");
+    awaitable.setProperty("sender", _engine->newQObject(sender));
+    awaitable.setProperty("signature", signature);
+    awaitable.setProperty("timeout", timeout);
+
+    return awaitable;
+}
+
+QJSValue TaskScheduler::all(const QJSValue &tasks)
+{
+    auto awaitable = _engine->newObject();
+
+    awaitable.setProperty(AWAIT_KEY, "all");
+    awaitable.setProperty("tasks", tasks);
+
+    return awaitable;
+}
+
+void TaskScheduler::sleep(int msecs)
+{
+    Waiter::sleep(msecs);
+}
+
+void TaskScheduler::resume(int id, const QJSValue &value)
+{
+    if (!_tasks.contains(id) || _tasks[id].finished)
+        return;
+
+    auto generator = _tasks[id].generator;
+    auto step = generator.property("next").callWithInstance(generator, {value});
+
+    if (step.isError())
+    {
+        if (_logger)
+            _logger->logError(QString("Task failed: %1").arg(step.toString()));
+
+        finish(id, QJSValue());
+        return;
+    }
+
+    if (step.property("done").toBool())
+        finish(id, step.property("value"));
+    else
+        suspend(id, step.property("value"));
+}
+
+void TaskScheduler::resumeWait(int id, int wait, const QJSValue &value, int msecs)
+{
+    QTimer::singleShot(qMax(0, msecs), Qt::PreciseTimer, this, [this, id, wait, value]() {wakeUp(id, wait, value);});
+}
+
+void TaskScheduler::wakeUp(int id, int wait, const QJSValue &value)
+{
+    // Only the wake-up of the task's current suspension counts, the first one wins.
+    if (!_tasks.contains(id) || _tasks[id].wait != wait)
+        return;
+
+    // A nested event loop of the running task, the wake-up waits until that task yields.
+    if (_running)
+    {
+        _pending.append({id, wait, value});
+        return;
+    }
+
+    auto &task = _tasks[id];
+
+    ++task.wait;
+    task.awaited.clear();
+
+    if (task.connection)
+    {
+        disconnect(task.connection);
+        _signalWaiters.remove(task.signalKey, TaskWait(id, wait));
+        task.connection = QMetaObject::Connection();
+    }
+
+    _running = id;
+    resume(id, value);
+    _running = 0;
+
+    for (auto &wakeup : _pending)
+        resumeWait(wakeup.id, wakeup.wait, wakeup.value);
+
+    _pending.clear();
+}
+
+void TaskScheduler::suspend(int id, const QJSValue &awaitable)
+{
+    auto &task = _tasks[id];
+    auto kind = awaitable.property(AWAIT_KEY).toString();
+
+    if (kind == "after")
+    {
+        resumeWait(id, task.wait, QJSValue(), awaitable.property("msecs").toInt());
+    }
+
+    else if (kind == "signal")
+    {
+        auto sender = awaitable.property("sender").toQObject();
+        auto signature = QMetaObject::normalizedSignature(awaitable.property("signature").toString().toLatin1().constData());
+        int index = sender ? sender->metaObject()->indexOfSignal(signature.constData()) : -1;
+
+        if (index < 0)
+        {
+            if (_logger)
+                _logger->logError(QString("Task waits for an unknown signal %1.").arg(QString(signature)));
+
+            resumeWait(id, task.wait, false);
+            return;
+        }
+
+        auto slot = metaObject()->method(metaObject()->indexOfSlot("onAwaitedSignal()"));
+
+        task.connection = connect(sender, sender->metaObject()->method(index), this, slot);
+        task.signalKey = SignalKey(sender, index);
+        _signalWaiters.insert(task.signalKey, TaskWait(id, task.wait));
+
+        int timeout = awaitable.property("timeout").toInt();
+
+        if (timeout >= 0)
+            resumeWait(id, task.wait, false, timeout);
+    }
+
+    else if (kind == "all")
+    {
+        task.awaited = taskIds(awaitable.property("tasks"));
+        resumeJoined();
+    }
+
+    else
+    {
+        // A bare yield only lets the other tasks run.
+        resumeWait(id, task.wait, awaitable);
+    }
+}
+
+void TaskScheduler::finish(int id, const QJSValue &result)
+{
+    if (_tasks.contains(id))
+    {
+        _tasks[id].finished = true;
+        _tasks[id].result = result;
+        _tasks[id].generator = QJSValue();
+    }
+
+    resumeJoined();
+    _waiter.wake();
+}
+
+void TaskScheduler::resumeJoined()
+{
+    QList<int> collected;
+
+    // Tasks waiting in all() for tasks that are all finished now.
+    for (auto it = _tasks.begin(); it != _tasks.end(); ++it)
+    {
+        auto &task = it.value();
+
+        if (task.finished || task.awaited.isEmpty())
+            continue;
+
+        bool ready = std::all_of(task.awaited.begin(), task.awaited.end(), [this](int awaited) {return isFinished(awaited);});
+
+        if (ready)
+        {
+            auto values = results(task.awaited);
+
+            collected += task.awaited;
+            task.awaited.clear();
+            resumeWait(it.key(), task.wait, values);
+        }
+    }
+
+    // The results have been handed over.
+    for (auto id : collected)
+        _tasks.remove(id);
+}
+
+void TaskScheduler::onAwaitedSignal()
+{
+    SignalKey key(sender(), senderSignalIndex());
+
+    for (auto &waiter : _signalWaiters.values(key))
+        resumeWait(waiter.first, waiter.second, true);
+}
+
+QList<int> TaskScheduler::taskIds(const QJSValue &tasks) const
+{
+    QList<int> ids;
+
+    if (tasks.isNumber())
+        ids.append(tasks.toInt());
+
+    for (int i = 0; i < tasks.property("length").toInt(); i++)
+        ids.append(tasks.property(quint32(i)).toInt());
+
+    return ids;
+}
+
+QJSValue TaskScheduler::results(const QList<int> &ids) const
+{
+    auto values = _engine->newArray(uint(ids.size()));
+
+    for (int i = 0; i < ids.size(); i++)
+        values.setProperty(quint32(i), _tasks.value(ids.at(i)).result);
+
+    return values;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QObject>
+#include <QJSEngine>
+#include <QJSValue>
+#include <QSharedPointer>
+#include <QMap>
+#include <QMultiHash>
+#include <QPair>
+
+#include "Logger.h"
+#include "Waiter.h"
+
+// Cooperative tasks for the test sequences, as the global "scheduler".
+//
+// A task is a JavaScript generator. Where a step would wait for a board it posts its
+// commands and yields an awaitable instead, and the thread is free to run other tasks
+// until that one is due, e.g. one task per board in railtestForCheckedDuts:
+//
+//     function* railtestBoard(testClient, slots, command, parsed)
+//     {
+//         testClient.postRailtestCommands(slots, command);
+//
+//         while(testClient.isRailtestPending())
+//             yield scheduler.signal(testClient, "railtestReplied(int)", RAILTEST_POLL_INTERVAL);
+//
+//         return testClient.takeRailtestResponses(parsed);
+//     }
+//
+// Awaitables are after(msecs), signal(object, signature, timeout) resuming with whether
+// the signal came, and all(tasks) resuming with their results; a bare yield gives way to
+// the others for one event loop pass. A blocking call inside a task (sleep(), Waiter based
+// TestClient calls) runs a nested event loop; other tasks due meanwhile are held back until
+// the running task yields, so a task step is never interleaved. That also means a task
+// should not join(): join() is the one blocking call, for plain functions.
+//
+// A finished task keeps its result until join() or all() collects it, or until
+// dropFinished(), which TestMethodManager calls after every test function.
+
+class TaskScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit TaskScheduler(QJSEngine *engine, QObject *parent = nullptr);
+
+    void setLogger(const QSharedPointer<Logger> &logger) {_logger = logger;}
+
+public slots:
+
+    // Starts generatorFunction(args...) as a task, the first step runs on the next event loop pass.
+    int spawn(const QJSValue &generatorFunction, const QJSValue &args = QJSValue());
+
+    // Runs the event loop until the tasks have finished, returns their results in order.
+    QJSValue join(const QJSValue &tasks);
+
+    QJSValue after(int msecs);
+    QJSValue signal(QObject *sender, const QString &signature, int timeout = -1);
+    QJSValue all(const QJSValue &tasks);
+
+    // Blocking sleep for code that is not a task; the thread still serves its events.
+    void sleep(int msecs);
+
+    bool isFinished(int task) const {return !_tasks.contains(task) || _tasks[task].finished;}
+
+    // Forgets finished tasks whose results nobody collected.
+    void dropFinished();
+
+private slots:
+
+    void onAwaitedSignal();
+
+private:
+
+    struct Task
+    {
+        QJSValue generator;
+        QJSValue result;
+        bool finished = false;
+
+        // Counts the suspensions, a wake-up meant for an earlier one is ignored.
+        int wait = 0;
+
+        // all() this task waits for, if any.
+        QList<int> awaited;
+        QMetaObject::Connection connection;
+        QPair<QObject*, int> signalKey;
+    };
+
+    typedef QPair<QObject*, int> SignalKey;
+    typedef QPair<int, int> TaskWait;
+
+    struct Wakeup
+    {
+        int id;
+        int wait;
+        QJSValue value;
+    };
+
+    void resume(int id, const QJSValue &value);
+    void resumeWait(int id, int wait, const QJSValue &value, int msecs = 0);
+    void wakeUp(int id, int wait, const QJSValue &value);
+    void suspend(int id, const QJSValue &awaitable);
+    void finish(int id, const QJSValue &result);
+    void resumeJoined();
+    QList<int> taskIds(const QJSValue &tasks) const;
+    QJSValue results(const QList<int> &ids) const;
+
+    QJSEngine *_engine;
+    QSharedPointer<Logger> _logger;
+    QMap<int, Task> _tasks;
+    QMultiHash<SignalKey, TaskWait> _signalWaiters;
+    int _nextId = 1;
+    int _running = 0;
+    QList<Wakeup> _pending;
+    Waiter _waiter;
+};
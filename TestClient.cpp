@@ -1,23 +1,82 @@
 #include "TestClient.h"
 
 #include <QCoreApplication>
+#include <QFileInfo>
+#include <QElapsedTimer>
 #include <QtEndian>
-#include <QSerialPortInfo>
-#include <math.h>
+#include <QQueue>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+#include "SerialPortRegistry.h"
+#include "ReferenceRadio.h"
+
+// Sampling converges once this many consecutive readings lie within the tolerance.
+static constexpr int SAMPLE_CONVERGENCE_WINDOW = 4;
+
+// Radio test: packet spacing of the DUT, longest wait for a decision, and the sequential
+// rule deciding once the RSSI mean lies RADIO_DECISION_Z standard errors off the limit.
+static constexpr int RADIO_TX_DELAY = 25;
+static constexpr int RADIO_WINDOW = 5000;
+static constexpr int RADIO_POLL_INTERVAL = 100;
+static constexpr int RADIO_TX_TAIL = 100;
+static constexpr int RADIO_MIN_SAMPLES = 5;
+static constexpr double RADIO_DECISION_Z = 3.0;
+
+// 1 pass, -1 fail, 0 not decided yet, after sent of count packets went out.
+static int radioDecision(const RunningStats &rssi, int count, int minRSSI, int sent)
+{
+    int received = int(rssi.count());
+    int needed = 2 * count / 3;
+
+    if (received + qMax(0, count - sent) < needed)
+        return -1;
+
+    if (received < RADIO_MIN_SAMPLES)
+        return 0;
+
+    double margin = RADIO_DECISION_Z * rssi.stddev() / std::sqrt(double(received));
+
+    if (rssi.mean() + margin < minRSSI)
+        return -1;
+
+    if (received >= needed && rssi.mean() - margin >= minRSSI)
+        return 1;
+
+    return 0;
+}
 
 TestClient::TestClient(const QSharedPointer<QSettings> &settings, int no, QObject *parent)
     : QObject(parent),
       _portManager(this),
+      _batch(&_portManager, this),
       _no(no),
       _settings(settings)
 {
     connect(&_portManager, &PortManager::responseRecieved, this, &TestClient::responseRecieved);
+    connect(&_portManager, &PortManager::asyncEvent, this, &TestClient::boardEvent);
+    connect(&_portManager, &PortManager::railtestReplied, this, &TestClient::railtestReplied);
+    connect(&_portManager, &PortManager::asyncEvent, this, [this](int code)
+    {
+        if (code == MB_EVENT_SLIP_ERROR)
+            ++_linkErrors;
+    });
+
+    // A board reset or brown-out switched everything off behind the tracked state's back.
+    connect(&_portManager, &PortManager::boardStarted, this, [this]()
+    {
+        resetSwitchState();
+
+        for (int slot = 1; slot <= DUT_SLOTS; slot++)
+            _railtestBaud[slot] = DEFAULT_RAILTEST_BAUD;
+    });
+
+    // The batch runs in the calling thread, so must the state tracking.
+    connect(&_batch, &CommandBatch::submitted, this, &TestClient::onBatchSubmitted, Qt::DirectConnection);
 
-    connect(this, &TestClient::slotFullyTested, [this](int slot){emit dutFullyTested(_duts[slot]);});
+    connect(this, &TestClient::slotFullyTested, [this](int slot){emit dutFullyTested(dut(slot));});
 
-    _duts[1] = dutTemplate;
-    _duts[2] = dutTemplate;
-    _duts[3] = dutTemplate;
 }
 
 TestClient::~TestClient()
@@ -29,6 +88,7 @@ void TestClient::setLogger(const QSharedPointer<Logger> &logger)
 {
     _logger = logger;
     _portManager.setLogger(logger);
+    _batch.setLogger(logger);
 }
 
 void TestClient::setPort(const QString &portName)
@@ -39,6 +99,7 @@ void TestClient::setPort(const QString &portName)
 void TestClient::open()
 {
     _portManager.open();
+    resetSwitchState();
 
     setTimeout(1000);
 
@@ -57,40 +118,63 @@ void TestClient::open()
 
 QStringList TestClient::availiblePorts() const
 {
-    auto availablePorts = QSerialPortInfo::availablePorts();
-    QStringList list;
-    for (auto & portInfo : availablePorts)
+    QStringList list = SerialPortRegistry::instance()->serialNumbers();
+
+    list += simulatorPorts().keys();
+    return list;
+}
+
+QMap<QString, QString> TestClient::simulatorPorts() const
+{
+    // Boards of the measuring board simulator, listed as "id=device path" pairs.
+    QMap<QString, QString> ports;
+
+    for (auto & port : _settings->value("Simulator/ports").toStringList())
     {
-        list.push_back(portInfo.serialNumber());
+        if (port.contains('='))
+            ports.insert(port.section('=', 0, 0), port.section('=', 1));
     }
-    return list;
+
+    return ports;
 }
 
 void TestClient::open(QString id)
 {
-    auto availablePorts = QSerialPortInfo::availablePorts();
-    for (auto & portInfo : availablePorts)
+    auto portName = SerialPortRegistry::instance()->portName(id);
+
+    if(!portName.isEmpty())
     {
-        if(portInfo.serialNumber() == id)
-        {
-            _portManager.setPort(portInfo.portName());
-            _portManager.open();
+        openPort(portName);
+        return;
+    }
 
-            setTimeout(1000);
-            int csa = readCSA(0);
-            if(csa != -1)
-            {
-                _isConnected = true;
-                _logger->logDebug(QString("Connection to the Measuring Board %1 has been established on %2").arg(_no).arg(portInfo.portName()));
-            }
+    // A simulated board, or a device path given directly.
+    auto simulatorPort = simulatorPorts().value(id);
 
-            else
-                _logger->logDebug(QString("Connection to the Measuring Board %1 has NOT been established").arg(_no));
+    if(!simulatorPort.isEmpty())
+        openPort(simulatorPort);
+    else if(id.startsWith('/') && QFileInfo::exists(id))
+        openPort(id);
+}
 
-            setTimeout(10000);
-            break;
-        }
+void TestClient::openPort(const QString &portName)
+{
+    _portManager.setPort(portName);
+    _portManager.open();
+    resetSwitchState();
+
+    setTimeout(1000);
+    int csa = readCSA(0);
+    if(csa != -1)
+    {
+        _isConnected = true;
+        _logger->logDebug(QString("Connection to the Measuring Board %1 has been established on %2").arg(_no).arg(portName));
     }
+
+    else
+        _logger->logDebug(QString("Connection to the Measuring Board %1 has NOT been established").arg(_no));
+
+    setTimeout(10000);
 }
 
 void TestClient::setDutsNumbers(QString numbers)
@@ -99,18 +183,23 @@ void TestClient::setDutsNumbers(QString numbers)
     int slot = 1;
     for(auto & i : numberList)
     {
-        _duts[slot]["no"] = i.toInt();
+        if (slot > DUT_SLOTS)
+            break;
+
+        _duts[slot].no = i.toInt();
         slot++;
     }
 }
 
 void TestClient::setDutChecked(int no, bool checked)
 {
-    for(auto & dut : _duts)
+    for(int slot = 1; slot <= DUT_SLOTS; slot++)
     {
-        if(dut["no"].toInt() == no)
+        auto &dut = _duts[slot];
+
+        if(dut.no == no)
         {
-            dut["checked"] = checked;
+            dut.checked = checked;
             break;
         }
     }
@@ -118,558 +207,795 @@ void TestClient::setDutChecked(int no, bool checked)
 
 void TestClient::addDutError(int slot, QString error)
 {
-    setDutProperty(slot, "error", _duts[slot]["error"].toString() + ";" + error);
+    setDutProperty(slot, "error", dut(slot).error + ";" + error);
 }
 
 void TestClient::setAllDutsChecked()
 {
-    for(auto & dut : _duts)
+    for(int slot = 1; slot <= DUT_SLOTS; slot++)
     {
-        if(dut["state"].toBool())
-            dut["checked"] = true;
+        auto &dut = _duts[slot];
+
+        if(dut.isAvailable())
+            dut.checked = true;
     }
 }
 
 void TestClient::reverseDutsChecked()
 {
-    for(auto & dut : _duts)
+    for(int slot = 1; slot <= DUT_SLOTS; slot++)
     {
-        if(dut["state"].toBool())
-            dut["checked"] = !dut["checked"].toBool();
+        auto &dut = _duts[slot];
+
+        if(dut.isAvailable())
+            dut.checked = !dut.checked;
     }
 }
 
 
-int TestClient::switchSWD(int slot)
+template <typename Command, typename... Values>
+int TestClient::boardCommand(Values... values)
 {
-    _currentSlot = slot;
-#pragma pack (push, 1)
-    struct Pkt
+    if (!Command::isValid(values...))
     {
-        MB_Packet_t h;
-        uint8_t dut;
-    };
-#pragma pack (pop)
+        _logger->logError(QString("Invalid argument for the measuring board command %1.").arg(Command::type));
+        return MB_ERROR_INVALID_ARGUMENT;
+    }
 
-    Pkt pkt;
+    return Command::decode(_portManager.slipCommand(0, Command::encode(values...)));
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_SWD);
-    pkt.h.sequence = 1;
-    pkt.h.dataLen = 1;
-    pkt.dut = slot;
+template <typename Command>
+int TestClient::boardCommand()
+{
+    static_assert(Command::argumentCount == 0, "Wrong number of measuring board command arguments");
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+    // Only the commands sent this way get their frame tables.
+    return Command::decode(_portManager.slipCommand(MbFixedFrames<Command::type>::table));
+}
+
+template <typename Command, typename... Values>
+QVariantMap TestClient::sampleBoard(int count, int interval, int tolerance, Values... values)
+{
+    QVariantMap result;
 
-    if(response.size())
+    if (!Command::isValid(values...) || count < 1 || interval < 0)
     {
-        return response[0].toInt();
+        _logger->logError(QString("Invalid argument for sampling the measuring board command %1.").arg(Command::type));
+        result.insert("errors", count);
+        return result;
     }
 
-    return -1;
-}
+    auto packet = Command::encode(values...);
+    RunningStats stats;
+    QQueue<quint8> pending;
+    QVector<int> recent;
+    QElapsedTimer clock;
+    int posted = 0;
+    int errors = 0;
+    int last = -1;
+    bool converged = false;
 
+    clock.start();
 
-int TestClient::powerOn(int slot)
-{
-#pragma pack (push, 1)
-    struct Pkt
+    while (!converged && (posted < count || !pending.isEmpty()))
     {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                state;
-    };
-#pragma pack (pop)
+        // Reads go out back to back up to the in-flight limit, or one per interval.
+        if (posted < count && pending.size() < _portManager.maxCommandsInFlight() && clock.elapsed() >= qint64(posted) * interval)
+        {
+            pending.enqueue(_portManager.postSlipCommand(0, packet));
+            ++posted;
+            continue;
+        }
+
+        if (pending.isEmpty())
+        {
+            delay(int(qint64(posted) * interval - clock.elapsed()));
+            continue;
+        }
+
+        int value = Command::decode(_portManager.waitSlipCommand(pending.dequeue()));
 
-    Pkt pkt;
+        if (value < 0)
+        {
+            ++errors;
+            continue;
+        }
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_POWER);
-    pkt.h.sequence = 2;
-    pkt.h.dataLen = 2;
-    pkt.dut = slot;
-    pkt.state = 1;
+        last = value;
+        stats.add(value);
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+        recent.append(value);
+        if (recent.size() > SAMPLE_CONVERGENCE_WINDOW)
+            recent.removeFirst();
 
-    if(response.size())
-    {
-        return response[0].toInt();
+        if (tolerance > 0 && recent.size() == SAMPLE_CONVERGENCE_WINDOW)
+        {
+            auto bounds = std::minmax_element(recent.begin(), recent.end());
+
+            converged = *bounds.second - *bounds.first <= tolerance;
+        }
     }
 
-    return -1;
+    // Reads still in flight once the readings converged are only collected.
+    while (!pending.isEmpty())
+        _portManager.waitSlipCommand(pending.dequeue());
+
+    result = stats.toVariantMap();
+    result.insert("errors", errors);
+    result.insert("last", last);
+    result.insert("converged", converged);
+    result.insert("settled", converged ? std::accumulate(recent.begin(), recent.end(), 0.0) / recent.size() : double(last));
+
+    return result;
 }
 
-int TestClient::powerOff(int slot)
+QVariantMap TestClient::sampleAIN(int slot, int AIN, int gain, int count, int interval, int tolerance)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                state;
-    };
-#pragma pack (pop)
+    return sampleBoard<MbReadAnalog>(count, interval, tolerance, slot, AIN, gain);
+}
 
-    Pkt pkt;
+QVariantMap TestClient::sampleCSA(int gain, int count, int interval, int tolerance)
+{
+    return sampleBoard<MbReadCsa>(count, interval, tolerance, gain);
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_POWER);
-    pkt.h.sequence = 3;
-    pkt.h.dataLen = 2;
-    pkt.dut = slot;
-    pkt.state = 0;
+QVariantMap TestClient::sampleDinADC(int slot, int DIN, int count, int interval, int tolerance)
+{
+    return sampleBoard<MbReadDinAdc>(count, interval, tolerance, slot, DIN);
+}
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+int TestClient::switchSWD(int slot)
+{
+    _currentSlot = slot;
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+    if (slotIndex(slot) && _swdSlot == slot)
+        return MB_NO_ERROR;
+
+    int result = boardCommand<MbSwitchSwd>(slot);
+    trackSwitch(MB_SWITCH_SWD, slot, true, result);
 
-    return -1;
+    return result;
 }
 
-int TestClient::readDIN(int slot, int DIN)
+int TestClient::powerOn(int slot)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                din;
-    };
-#pragma pack (pop)
+    if (slotIndex(slot) && _power[slot] == PowerOn)
+        return MB_NO_ERROR;
 
-    Pkt pkt;
+    int result = boardCommand<MbSwitchPower>(slot, 1);
+    trackSwitch(MB_SWITCH_POWER, slot, true, result);
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_DIN);
-    pkt.h.sequence = 4;
-    pkt.h.dataLen = 2;
-    pkt.dut = slot;
-    pkt.din = DIN;
+    return result;
+}
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+int TestClient::powerOff(int slot)
+{
+    if (slotIndex(slot) && _power[slot] == PowerOff)
+        return MB_NO_ERROR;
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+    int result = boardCommand<MbSwitchPower>(slot, 0);
+    trackSwitch(MB_SWITCH_POWER, slot, false, result);
 
-    return -1;
+    return result;
 }
 
-int TestClient::setDOUT(int slot, int DOUT)
+int TestClient::ensurePowered(int slot)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                dout,
-                state;
-    };
-#pragma pack (pop)
+    int result = powerOn(slot);
 
-    Pkt pkt;
+    if (result != MB_NO_ERROR || !slotIndex(slot))
+        return result;
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_WRITE_DOUT);
-    pkt.h.sequence = 5;
-    pkt.h.dataLen = 3;
-    pkt.dut = slot;
-    pkt.dout = DOUT;
-    pkt.state = 1;
+    int settleTime = _settings->value("TestBoard/powerSettleTime", 1000).toInt();
+    qint64 remaining = settleTime - _poweredSince[slot].elapsed();
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+    if (remaining > 0)
+        delay(int(remaining));
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+    return result;
+}
 
-    return -1;
+void TestClient::resetSwitchState()
+{
+    for (auto & power : _power)
+        power = PowerUnknown;
+
+    _swdSlot = 0;
 }
 
-int TestClient::clearDOUT(int slot, int DOUT)
+void TestClient::trackSwitch(int type, int slot, bool on, int result)
 {
-#pragma pack (push, 1)
-    struct Pkt
+    if (!slotIndex(slot))
+        return;
+
+    if (type == MB_SWITCH_SWD)
     {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                dout,
-                state;
-    };
-#pragma pack (pop)
+        _swdSlot = result == MB_NO_ERROR ? slot : 0;
+        return;
+    }
 
-    Pkt pkt;
+    if (result != MB_NO_ERROR)
+    {
+        _power[slot] = PowerUnknown;
+        return;
+    }
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_WRITE_DOUT);
-    pkt.h.sequence = 6;
-    pkt.h.dataLen = 3;
-    pkt.dut = slot;
-    pkt.dout = DOUT;
-    pkt.state = 0;
+    // The settle time runs from the off->on edge, not from a repeated switch-on.
+    if (on && _power[slot] != PowerOn)
+        _poweredSince[slot].start();
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+    _power[slot] = on ? PowerOn : PowerOff;
 
-    if(response.size())
+    // The DUT starts at the default rate again, so does its board channel. Here rather than
+    // in powerOff(), a power-off sent in a batch comes this way too.
+    if (!on && _railtestBaud[slot] != DEFAULT_RAILTEST_BAUD)
     {
-        return response[0].toInt();
+        _railtestBaud[slot] = DEFAULT_RAILTEST_BAUD;
+        configDutDebug(slot, DEFAULT_RAILTEST_BAUD);
     }
-
-    return -1;
 }
 
-int TestClient::readCSA(int gain)
+void TestClient::onBatchSubmitted(const QList<QByteArray> &packets, const QVariantList &results)
 {
-#pragma pack (push, 1)
-    struct Pkt
+    for (int i = 0; i < packets.size(); i++)
     {
-        MB_Packet_t h;
-        uint8_t gain;
-    };
-#pragma pack (pop)
-
-    Pkt pkt;
+        auto &packet = packets.at(i);
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_CSA);
-    pkt.h.sequence = 7;
-    pkt.h.dataLen = 1;
-    pkt.gain = gain;
+        if (packet.size() < int(sizeof(MB_Packet_t)) + 1)
+            continue;
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+        auto header = reinterpret_cast<const MB_Packet_t*>(packet.constData());
+        auto data = packet.constData() + sizeof(MB_Packet_t);
+        auto type = qFromBigEndian(header->type);
 
-    if(response.size())
-    {
-        return response[0].toInt();
+        if (type == MB_SWITCH_SWD)
+            trackSwitch(type, data[0], true, results.value(i, -1).toInt());
+        else if (type == MB_SWITCH_POWER && header->dataLen >= 2)
+            trackSwitch(type, data[0], data[1], results.value(i, -1).toInt());
     }
+}
 
-    return -1;
+int TestClient::readDIN(int slot, int DIN)
+{
+    return boardCommand<MbReadDin>(slot, DIN);
 }
 
-int TestClient::readAIN(int slot, int AIN, int gain)
+int TestClient::setDOUT(int slot, int DOUT)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                ain,
-                gain;
-    };
-#pragma pack (pop)
+    return boardCommand<MbWriteDout>(slot, DOUT, 1);
+}
 
-    Pkt pkt;
+int TestClient::clearDOUT(int slot, int DOUT)
+{
+    return boardCommand<MbWriteDout>(slot, DOUT, 0);
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_ANALOG);
-    pkt.h.sequence = 8;
-    pkt.h.dataLen = 3;
-    pkt.dut = slot;
-    pkt.ain = AIN;
-    pkt.gain = gain;
+int TestClient::readCSA(int gain)
+{
+    return boardCommand<MbReadCsa>(gain);
+}
 
+int TestClient::readAIN(int slot, int AIN, int gain)
+{
     _currentSlot = slot;
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+    return boardCommand<MbReadAnalog>(slot, AIN, gain);
+}
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+int TestClient::daliOn()
+{
+    return boardCommand<MbSwitchDali>(1);
+}
 
-    return -1;
+int TestClient::daliOff()
+{
+    return boardCommand<MbSwitchDali>(0);
 }
 
-int TestClient::daliOn()
+int TestClient::readDaliADC()
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t state;
-    };
-#pragma pack (pop)
+    return boardCommand<MbReadDaliAdc>();
+}
 
-    Pkt pkt;
+int TestClient::readDinADC(int slot, int DIN)
+{
+    return boardCommand<MbReadDinAdc>(slot, DIN);
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_DALI);
-    pkt.h.sequence = 10;
-    pkt.h.dataLen = 1;
-    pkt.state = 1;
+int TestClient::read24V()
+{
+    return boardCommand<MbReadAdc24V>();
+}
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+int TestClient::read3V()
+{
+    return boardCommand<MbReadAdc3V>();
+}
 
-    if(response.size())
+int TestClient::readTemperature()
+{
+    return boardCommand<MbReadAdcTemp>();
+}
+
+int TestClient::configDutDebug(int slot, int baudRate, int bits, int parity, int stopBits)
+{
+    if (!slotIndex(slot) || baudRate <= 0 || (bits != 8 && bits != 9) || parity < 0 || parity > 2 || stopBits < 1 || stopBits > 2)
     {
-        return response[0].toInt();
+        _logger->logError(QString("Invalid argument for the measuring board command %1.").arg(MB_CONFIG_DUT_DEBUG));
+        return MB_ERROR_INVALID_ARGUMENT;
     }
 
-    return -1;
+    MB_ConfigDutDebug_t packet;
+
+    packet.header.type = qToBigEndian<quint16>(MB_CONFIG_DUT_DEBUG);
+    packet.header.sequence = 0;
+    packet.header.dataLen = sizeof(packet) - sizeof(packet.header);
+    packet.dutIndex = quint8(slot);
+    packet.baudRate = qToBigEndian<quint32>(quint32(baudRate));
+    packet.bits = quint8(bits);
+    packet.parity = quint8(parity);
+    packet.stopBits = quint8(stopBits);
+
+    auto response = _portManager.slipCommand(0, QByteArray(reinterpret_cast<const char*>(&packet), sizeof(packet)));
+
+    return response.isEmpty() ? -1 : response[0].toInt();
 }
 
-int TestClient::daliOff()
+int TestClient::negotiateRailtestBaud(int slot)
 {
-#pragma pack (push, 1)
-    struct Pkt
+    if (!slotIndex(slot))
+        return 0;
+
+    for (auto & value : _settings->value("Railtest/baudRates").toStringList())
     {
-        MB_Packet_t h;
-        uint8_t state;
-    };
-#pragma pack (pop)
+        int baudRate = value.trimmed().toInt();
 
-    Pkt pkt;
+        // Rates are listed fastest first, the first one that works is kept.
+        if (baudRate <= _railtestBaud[slot])
+            break;
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_DALI);
-    pkt.h.sequence = 11;
-    pkt.h.dataLen = 1;
-    pkt.state = 0;
+        if (_failedBauds[slot].contains(baudRate))
+            continue;
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+        int previous = _railtestBaud[slot];
 
-    if(response.size())
-    {
-        return response[0].toInt();
+        if (switchRailtestBaud(slot, baudRate))
+        {
+            _logger->logDebug(QString("Railtest of DUT %1 runs at %2 baud.").arg(dutNo(slot)).arg(baudRate));
+            break;
+        }
+
+        _failedBauds[slot].insert(baudRate);
+
+        // A rate the DUT refused left both sides where they were.
+        if (_railtestBaud[slot] != previous)
+            restoreRailtestBaud(slot);
     }
 
-    return -1;
+    return _railtestBaud[slot];
 }
 
-int TestClient::readDaliADC()
+bool TestClient::switchRailtestBaud(int slot, int baudRate)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-    };
-#pragma pack (pop)
+    auto command = _settings->value("Railtest/baudCommand", "setBaudRate %1").toString().arg(baudRate);
+    QMap<int, QByteArray> commands;
 
-    Pkt pkt;
+    commands.insert(slot, command.toUtf8());
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_DALI_ADC);
-    pkt.h.sequence = 12;
-    pkt.h.dataLen = 0;
+    // The DUT answers at the old rate and switches after the prompt, unless it refuses the rate.
+    auto replies = _portManager.railtestReplies(commands).value(slot);
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+    if (replies.isEmpty())
+        return false;
 
-    if(response.size())
+    for (auto & reply : replies)
     {
-        return response[0].toInt();
+        if (reply.contains(QLatin1String("error")))
+            return false;
     }
 
-    return -1;
+    // From here on the DUT is at the new rate, a failure needs restoreRailtestBaud().
+    _railtestBaud[slot] = baudRate;
+
+    return configDutDebug(slot, baudRate) == MB_NO_ERROR && probeRailtest(slot);
 }
 
-int TestClient::readDinADC(int slot, int DIN)
+void TestClient::restoreRailtestBaud(int slot)
 {
-#pragma pack (push, 1)
-    struct Pkt
+    _portManager.setTimeout(1000);
+
+    // Railtest restarts at the default rate after a reset. The reset may not get through
+    // at a broken rate, then a power cycle restarts it.
+    _portManager.railtestCommand(slot, "reset");
+    configDutDebug(slot, DEFAULT_RAILTEST_BAUD);
+    _railtestBaud[slot] = DEFAULT_RAILTEST_BAUD;
+
+    if (!probeRailtest(slot))
     {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                din;
-    };
-#pragma pack (pop)
+        _logger->logDebug(QString("Railtest of DUT %1 does not answer after a reset, power cycling it.").arg(dutNo(slot)));
+        powerOff(slot);
+        ensurePowered(slot);
+
+        for (int attempt = 0; attempt < 3 && !probeRailtest(slot); ++attempt)
+            ;
+    }
 
-    Pkt pkt;
+    _portManager.setTimeout(10000);
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_DIN_ADC);
-    pkt.h.sequence = 13;
-    pkt.h.dataLen = 2;
-    pkt.dut = slot;
-    pkt.din = DIN;
+bool TestClient::probeRailtest(int slot)
+{
+    auto probe = _settings->value("Railtest/probeCommand", "getVersion").toByteArray();
+    auto probeName = probe.split(' ').first();
+    int linkErrors = _linkErrors;
+    QMap<int, QByteArray> commands;
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+    commands.insert(slot, probe);
 
-    if(response.size())
+    // Any record echoing the command name proves the text arrived intact, even an error record.
+    for (auto & reply : _portManager.railtestReplies(commands).value(slot))
     {
-        return response[0].toInt();
+        if (reply.name() == QLatin1String(probeName))
+            return _linkErrors == linkErrors;
     }
 
-    return -1;
+    return false;
 }
 
-int TestClient::read24V()
+QList<int> TestClient::failedRaisedSlots(const QList<int> &slotList, const QSet<int> &replied, int linkErrors)
 {
-#pragma pack (push, 1)
-    struct Pkt
+    QList<int> failed;
+
+    for (auto slot : slotList)
     {
-        MB_Packet_t h;
-    };
-#pragma pack (pop)
+        if (!slotIndex(slot) || _railtestBaud[slot] == DEFAULT_RAILTEST_BAUD)
+            continue;
+
+        if (!replied.contains(slot) || _linkErrors != linkErrors)
+        {
+            _logger->logInfo(QString("Railtest link of DUT %1 failed at %2 baud, falling back to %3.")
+                                .arg(dutNo(slot)).arg(_railtestBaud[slot]).arg(DEFAULT_RAILTEST_BAUD));
+            _failedBauds[slot].insert(_railtestBaud[slot]);
+            restoreRailtestBaud(slot);
+            failed.append(slot);
+        }
+    }
 
-    Pkt pkt;
+    return failed;
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_ADC_24V);
-    pkt.h.sequence = 14;
-    pkt.h.dataLen = 0;
+QVariantMap TestClient::benchmarkRailtest(int slot, const QByteArray &cmd, int count)
+{
+    QElapsedTimer timer;
+    qint64 bytes = 0;
+    int replies = 0;
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+    timer.start();
 
-    if(response.size())
+    for (int i = 0; i < count; ++i)
     {
-        return response[0].toInt();
+        if (_portManager.railtestCommand(slot, cmd).isEmpty())
+            continue;
+
+        ++replies;
+        bytes += _portManager.railtestReplySize(slot);
     }
 
-    return -1;
+    qint64 msecs = qMax<qint64>(1, timer.elapsed());
+    QVariantMap result;
+
+    result.insert("baud", railtestBaud(slot));
+    result.insert("commands", count);
+    result.insert("replies", replies);
+    result.insert("bytes", bytes);
+    result.insert("msecs", msecs);
+    result.insert("commandsPerSecond", 1000.0 * replies / msecs);
+    result.insert("bytesPerSecond", 1000.0 * bytes / msecs);
+
+    return result;
 }
 
-int TestClient::read3V()
+CommandBatch *TestClient::batch()
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-    };
-#pragma pack (pop)
+    _batch.clear();
 
-    Pkt pkt;
+    return &_batch;
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_ADC_3V);
-    pkt.h.sequence = 15;
-    pkt.h.dataLen = 0;
+QStringList TestClient::railtestCommand(int channel, const QByteArray &cmd)
+{
+    int linkErrors = _linkErrors;
+    auto response = _portManager.railtestCommand(channel, cmd);
+    QSet<int> replied;
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+    if (!response.isEmpty())
+        replied.insert(channel);
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+    if (!failedRaisedSlots(QList<int>() << channel, replied, linkErrors).isEmpty())
+        response = _portManager.railtestCommand(channel, cmd);
 
-    return -1;
+    return response;
 }
 
-int TestClient::readTemperature()
+QVariantMap TestClient::railtestCommands(const QVariantList &slotList, const QByteArray &cmd)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-    };
-#pragma pack (pop)
+    postRailtestCommands(slotList, cmd);
+    return takeRailtestResponses(false);
+}
 
-    Pkt pkt;
+QVariantMap TestClient::railtestReplies(const QVariantList &slotList, const QByteArray &cmd)
+{
+    postRailtestCommands(slotList, cmd);
+    return takeRailtestResponses(true);
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_ADC_TEMP);
-    pkt.h.sequence = 16;
-    pkt.h.dataLen = 0;
+void TestClient::postRailtestCommands(const QVariantList &slotList, const QByteArray &cmd)
+{
+    QMap<int, QByteArray> commands;
 
-    auto response = _portManager.slipCommand(0, QByteArray((char*)&pkt, sizeof(pkt)));
+    for (auto & slot : slotList)
+        commands.insert(slot.toInt(), cmd);
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+    _postedRailtest.clear();
+    _postedLinkErrors = _linkErrors;
 
-    return -1;
+    for (auto slot : _portManager.postRailtestCommands(commands))
+        _postedRailtest.insert(slot, cmd);
 }
 
-QStringList TestClient::railtestCommand(int channel, const QByteArray &cmd)
+bool TestClient::isRailtestPending() const
 {
-    return _portManager.railtestCommand(channel, cmd);
+    for (auto slot : _postedRailtest.keys())
+    {
+        if (_portManager.isRailtestPending(slot))
+            return true;
+    }
+
+    return false;
 }
 
-void TestClient::testRadio(int slot, QString RfModuleId, int channel, int power, int minRSSI, int maxRSSI, int count)
+QVariantMap TestClient::takeRailtestResponses(bool parsed)
 {
-    RailtestClient rf;
-    _rssiValues.clear();
+    auto commands = _postedRailtest;
+    QVariantMap result;
+    QSet<int> replied;
 
-    connect(&rf, &RailtestClient::replyReceived, this, &TestClient::onRfReplyReceived);
+    _postedRailtest.clear();
 
-    auto availablePorts = QSerialPortInfo::availablePorts();
-    QString portName;
-    for (auto & portInfo : availablePorts)
+    if (!parsed)
     {
-        if(portInfo.serialNumber() == RfModuleId)
+        auto responses = _portManager.railtestResponses(commands.keys());
+
+        for (auto it = responses.begin(); it != responses.end(); ++it)
         {
-            portName = portInfo.portName();
-            break;
+            if (!it.value().isEmpty())
+                replied.insert(it.key());
         }
+
+        for (auto slot : failedRaisedSlots(commands.keys(), replied, _postedLinkErrors))
+            responses.insert(slot, _portManager.railtestCommand(slot, commands.value(slot)));
+
+        for (auto it = responses.begin(); it != responses.end(); ++it)
+            result.insert(QString().setNum(it.key()), it.value());
+
+        return result;
+    }
+
+    auto replies = _portManager.railtestRecords(commands.keys());
+
+    for (auto it = replies.begin(); it != replies.end(); ++it)
+    {
+        if (!it.value().isEmpty())
+            replied.insert(it.key());
+    }
+
+    QMap<int, QByteArray> retries;
+
+    for (auto slot : failedRaisedSlots(commands.keys(), replied, _postedLinkErrors))
+        retries.insert(slot, commands.value(slot));
+
+    if (!retries.isEmpty())
+    {
+        auto retried = _portManager.railtestReplies(retries);
+
+        for (auto it = retried.begin(); it != retried.end(); ++it)
+            replies.insert(it.key(), it.value());
     }
 
-    if (!rf.open(portName))
+    for (auto it = replies.begin(); it != replies.end(); ++it)
     {
-        _logger->logError("Cannot open serial port for reference radio module.");
-        _logger->logDebug("Cannot open serial port for reference radio module.");
-        _duts[slot]["error"] = _duts[slot]["error"].toString() + "; " + "Cannot open serial port for reference radio module.";
+        QVariantList records;
+
+        for (auto & reply : it.value())
+            records.append(reply.toVariantMap());
+
+        result.insert(QString().setNum(it.key()), records);
+    }
+
+    return result;
+}
+
+void TestClient::testRadio(int slot, QString RfModuleId, int channel, int power, int minRSSI, int maxRSSI, int count)
+{
+    auto radio = ReferenceRadio::instance(RfModuleId);
+
+    if (!radio->ready())
+    {
+        _logger->logError(radio->lastError());
+        _logger->logDebug(radio->lastError());
+        _duts[slotIndex(slot)].error += "; " + radio->lastError();
         return;
     }
 
-    rf.syncCommand("reset", "", 2000);
-    if (!rf.waitCommandPrompt())
+    // Every command waits for the DUT's prompt, nothing to sleep for in between.
+    if (!prepareRadioTx(slot, channel, power, RADIO_TX_DELAY))
+        return;
+
+    // The module keeps its settings between DUTs, only a channel change is sent.
+    if (!radio->listenBle(channel))
     {
-        _logger->logError("Timeout waiting reference radio module command prompt.");
-        _logger->logDebug("Timeout waiting reference radio module command prompt.");
-        _duts[slot]["error"] = _duts[slot]["error"].toString() + "; " + "Timeout waiting reference radio module command prompt.";
+        _logger->logError(radio->lastError());
+        _logger->logDebug(radio->lastError());
+        _duts[slotIndex(slot)].error += "; " + radio->lastError();
         return;
     }
 
-    rf.syncCommand("rx", "0", 500);
-    _rfRSSI = 255;
-    _rfCount = 0;
-    rf.syncCommand("setBleMode", "1", 500);
-    rf.syncCommand("setBle1Mbps", "1", 500);
-    rf.syncCommand("setChannel", QString().setNum(channel).toLocal8Bit(), 500);
+    // Packets of the DUT tested before must not count for this one.
+    radio->waitQuiet();
+
+    _rssi.reset();
+    _rfTxEnded = false;
+
+    // The receiver lives in the thread running the test, so _rssi and _rfWaiter are only ever
+    // touched here: a sender in another thread, e.g. the board thread, queues to the wait below.
+    QObject receiver;
+
+    connect(radio, &ReferenceRadio::replyReceived, &receiver, [this](QString id, QVariantMap params) {onRfReplyReceived(id, params);});
+    connect(&_portManager, &PortManager::railtestOutput, &receiver, [this, slot](int channel, QByteArray line)
+    {
+        if (channel == slot && RailtestReply::parseLine(line).name() == QLatin1String("txEnd"))
+        {
+            _rfTxEnded = true;
+            _rfWaiter.wake();
+        }
+    });
+
+    QElapsedTimer clock;
+    QElapsedTimer tail;
+
+    if (railtestCommand(slot, QString("tx %1").arg(count).toLocal8Bit()).isEmpty())
+        _logger->logDebug(QString("No reply to tx from DUT %1.").arg(dutNo(slot)));
 
-    railtestCommand(slot, "rx 0");
-    delay(500);
+    clock.start();
 
-    railtestCommand(slot, "setBleMode 1");
-    delay(500);
+    // Ends on a decision, on every packet received, or shortly after the DUT reported txEnd;
+    // RADIO_WINDOW is only the guard.
+    while (clock.elapsed() < RADIO_WINDOW)
+    {
+        // Packets reach us a little after they went out, one spacing of slack keeps a slow report from failing the DUT.
+        int sent = _rfTxEnded ? count : int(clock.elapsed() / RADIO_TX_DELAY) - 1;
+
+        if (radioDecision(_rssi, count, minRSSI, sent) || _rssi.count() >= quint64(count))
+            break;
+
+        // After txEnd only the reports of the last packets are still on their way.
+        if (_rfTxEnded && !tail.isValid())
+            tail.start();
+
+        if (tail.isValid() && tail.elapsed() >= RADIO_TX_TAIL)
+            break;
+
+        auto received = _rssi.count();
+        bool txEnded = _rfTxEnded;
 
-    railtestCommand(slot, "setBle1Mbps 1");
-    delay(500);
+        _rfWaiter.wait([this, received, txEnded]() {return _rssi.count() != received || _rfTxEnded != txEnded;},
+                       int(qMin<qint64>(RADIO_POLL_INTERVAL, RADIO_WINDOW - clock.elapsed())));
+    }
 
-    railtestCommand(slot, QString("setChannel %1").arg(channel).toLocal8Bit());
-    delay(500);
+    disconnect(radio, nullptr, &receiver, nullptr);
+    disconnect(&_portManager, nullptr, &receiver, nullptr);
 
-    railtestCommand(slot, QString("setPower %1").arg(power).toLocal8Bit());
-    delay(500);
+    // A decision before the last packet leaves the DUT transmitting for a while.
+    if (!_rfTxEnded)
+        radio->expectTraffic(int(count * RADIO_TX_DELAY - clock.elapsed()));
 
-    railtestCommand(slot, "setTxDelay 25");
-    delay(500);
+    _logger->logDebug(QString("Radio test for DUT %1 decided after %2 packets, %3 ms.").arg(dutNo(slot)).arg(_rssi.count()).arg(clock.elapsed()));
+    setDutProperty(slot, "radioPackets", _rssi.count());
+
+    checkRadio(slot, power, count, minRSSI, _rssi.toVariantMap());
+}
 
-    rf.syncCommand("rx", "1", 500);
+bool TestClient::prepareRadioTx(int slot, int channel, int power, int period, int markerOffset, int marker)
+{
+    QList<QByteArray> commands
+    {
+        "rx 0",
+        "setBleMode 1",
+        "setBle1Mbps 1",
+        QString("setChannel %1").arg(channel).toLocal8Bit(),
+        QString("setPower %1").arg(power).toLocal8Bit(),
+        QString("setTxDelay %1").arg(period).toLocal8Bit()
+    };
 
-    railtestCommand(slot, QString("tx %1").arg(count).toLocal8Bit());
-    delay(5000);
+    if (marker >= 0)
+        commands.append(QString("setTxPayload %1 %2").arg(markerOffset).arg(marker).toLocal8Bit());
 
-    double sumRSSI = 0;
-    for (auto & i : _rssiValues)
+    for (auto & command : commands)
     {
-        sumRSSI += i;
+        if (railtestCommand(slot, command).isEmpty())
+        {
+            _logger->logError(QString("Radio Interface testing failure for DUT %1.").arg(dutNo(slot)));
+            _logger->logDebug(QString("Radio Interface failure for DUT %1: no reply to %2.").arg(dutNo(slot)).arg(QString(command)));
+            _duts[slotIndex(slot)].setCheck(RadioChecked, false);
+            _duts[slotIndex(slot)].error += QString("; Radio Interface failure: no reply to %1.").arg(QString(command));
+            return false;
+        }
     }
-    double averageRSSI = sumRSSI / _rssiValues.size();
 
-    double s0 = 0;
-    foreach(int v, _rssiValues) s0 += pow(v - averageRSSI, 2);
-    s0 = sqrt(s0 / (_rssiValues.size() - 1));
-    _logger->logDebug(QString("For DUT %1 power: %2, packet recieved: %3, Average RSSI: %4, S0: %5.").arg(dutNo(slot)).arg(power).arg(_rssiValues.size()).arg(averageRSSI).arg(s0));
+    return true;
+}
 
-    if (_rfCount < (2 * count / 3))
+bool TestClient::startRadioTx(int slot, int count)
+{
+    return !railtestCommand(slot, QString("tx %1").arg(count).toLocal8Bit()).isEmpty();
+}
+
+bool TestClient::checkRadio(int slot, int power, int count, int minRSSI, const QVariantMap &packets)
+{
+    int received = packets.value("count").toInt();
+    double averageRSSI = packets.value("mean").toDouble();
+
+    _logger->logDebug(QString("For DUT %1 power: %2, packet recieved: %3, Average RSSI: %4, S0: %5.").arg(dutNo(slot)).arg(power).arg(received).arg(averageRSSI).arg(packets.value("stddev").toDouble()));
+
+    if (received < (2 * count / 3))
     {
         _logger->logError(QString("Radio Interface testing failure for DUT %1.").arg(dutNo(slot)));
-        _logger->logDebug(QString("Radio Interface failure for DUT %1: packet lost (%2).").arg(dutNo(slot)).arg(_rfCount));
-        _duts[slot]["radioChecked"] = false;
-        _duts[slot]["error"] = _duts[slot]["error"].toString() + "; " + QString("Radio Interface failure: packet lost (%1).").arg(_rfCount);
+        _logger->logDebug(QString("Radio Interface failure for DUT %1: packet lost (%2).").arg(dutNo(slot)).arg(received));
+        _duts[slotIndex(slot)].setCheck(RadioChecked, false);
+        _duts[slotIndex(slot)].error += QString("; Radio Interface failure: packet lost (%1).").arg(received);
+        return false;
     }
 
-    else if (averageRSSI < minRSSI)
+    if (averageRSSI < minRSSI)
     {
         _logger->logError(QString("Radio Interface testing failure for DUT %1.").arg(dutNo(slot)));
         _logger->logDebug(QString("Radio Interface failure for DUT %1: RSSI (%2) is out of bounds.").arg(dutNo(slot)).arg(averageRSSI));
-        _duts[slot]["radioChecked"] = false;
-        _duts[slot]["error"] = _duts[slot]["error"].toString() + "; " + QString("Radio Interface failure: RSSI (%1) is out of bounds.").arg(averageRSSI);
+        _duts[slotIndex(slot)].setCheck(RadioChecked, false);
+        _duts[slotIndex(slot)].error += QString("; Radio Interface failure: RSSI (%1) is out of bounds.").arg(averageRSSI);
+        return false;
     }
 
-    else
+    _logger->logSuccess(QString("Radio interface for DUT %1 has been tested successfully.").arg(dutNo(slot)));
+    _duts[slotIndex(slot)].setCheck(RadioChecked, true);
+    return true;
+}
+
+QObject *TestClient::referenceRadio(const QString &moduleId)
+{
+    return ReferenceRadio::instance(moduleId);
+}
+
+void TestClient::logLatencyStatistics()
+{
+    auto statistics = _portManager.latencyStatistics();
+
+    for (auto & group : QStringList {"slip", "railtest"})
     {
-        _logger->logSuccess(QString("Radio interface for DUT %1 has been tested successfully.").arg(dutNo(slot)));
-        _duts[slot]["radioChecked"] = true;
+        auto commands = statistics.value(group).toMap();
+
+        for (auto it = commands.begin(); it != commands.end(); ++it)
+        {
+            auto values = it.value().toMap();
+
+            _logger->logDebug(QString("Measuring board %1, %2 %3: count=%4, p50=%5 us, p99=%6 us, max=%7 us, timeout=%8 ms")
+                              .arg(_no).arg(group).arg(it.key())
+                              .arg(values.value("count").toULongLong())
+                              .arg(values.value("p50").toLongLong())
+                              .arg(values.value("p99").toLongLong())
+                              .arg(values.value("max").toLongLong())
+                              .arg(values.value("timeout").toInt()));
+        }
     }
 }
 
@@ -682,53 +1008,97 @@ void TestClient::onRfReplyReceived(QString id, QVariantMap params)
 
         if (ok)
         {
-            ++_rfCount;
 //            _logger->logDebug(QString("RSSI value recieved: %1").arg(rssi));
-            _rssiValues.push_back(rssi);
-            if (rssi < _rfRSSI)
-                _rfRSSI = rssi;
+            _rssi.add(rssi);
+            _rfWaiter.wake();
         }
     }
 }
 
 void TestClient::delay(int msec)
 {
-    QTime expire = QTime::currentTime().addMSecs(msec);
-    while (QTime::currentTime() <= expire)
-    {
-        QCoreApplication::processEvents();
-    }
+    Waiter::sleep(msec);
 }
 
 void TestClient::resetDut(int slot)
 {
-    _duts[slot]["state"] = DutState::inactive;
-    _duts[slot]["id"] = "";
-    _duts[slot]["checked"] = false;
-    _duts[slot]["voltageChecked"] = false;
-    _duts[slot]["accelChecked"] = false;
-    _duts[slot]["lightSensChecked"] = false;
-    _duts[slot]["daliChecked"] = false;
-    _duts[slot]["radioChecked"] = false;
-    _duts[slot]["error"] = "";
-
-    emit dutChanged(_duts[slot]);
+    QMutexLocker locker(&_dutChangesMutex);
+    auto &dut = _duts[slotIndex(slot)];
+
+    dut.state = DutState::inactive;
+    dut.id.clear();
+    dut.checked = false;
+    dut.setCheck(VoltageChecked, false);
+    dut.setCheck(AccelChecked, false);
+    dut.setCheck(LightSensChecked, false);
+    dut.setCheck(DaliChecked, false);
+    dut.setCheck(RadioChecked, false);
+    dut.error.clear();
+    locker.unlock();
+
+    markDutChanged(slot, DutAllFields);
 }
 
 void TestClient::setDutProperty(int slot, const QString &property, const QVariant &value)
 {
-    _duts[slot][property] = value;
-    emit dutChanged(_duts[slot]);
+    QMutexLocker locker(&_dutChangesMutex);
+    auto fields = _duts[slotIndex(slot)].setProperty(property, value);
+    locker.unlock();
+
+    markDutChanged(slot, fields);
+}
+
+void TestClient::markDutChanged(int slot, quint32 fields)
+{
+    if (!fields || slotIndex(slot) == 0)
+        return;
+
+    QMutexLocker locker(&_dutChangesMutex);
+
+    _dutChanges[slot] |= fields;
+
+    if (_dutChangesPosted)
+        return;
+
+    _dutChangesPosted = true;
+    QMetaObject::invokeMethod(this, &TestClient::flushDutChanges, Qt::QueuedConnection);
+}
+
+void TestClient::flushDutChanges()
+{
+    DutChanges changes;
+
+    {
+        QMutexLocker locker(&_dutChangesMutex);
+
+        for (int slot = 1; slot <= DUT_SLOTS; slot++)
+        {
+            if (!_dutChanges[slot])
+                continue;
+
+            DutChange change;
+            change.dut = _duts[slot];
+            change.fields = _dutChanges[slot];
+            changes.append(change);
+
+            _dutChanges[slot] = 0;
+        }
+
+        _dutChangesPosted = false;
+    }
+
+    if (!changes.isEmpty())
+        emit dutsChanged(changes);
 }
 
 QVariant TestClient::dutProperty(int slot, const QString &property)
 {
-    return _duts[slot][property];
+    return _duts[slotIndex(slot)].property(property);
 }
 
 bool TestClient::isActive() const
 {
-    for(int slot = 1; slot < _duts.size() + 1; slot++)
+    for(int slot = 1; slot <= DUT_SLOTS; slot++)
     {
         if(isDutAvailable(slot) && isDutChecked(slot))
         {
@@ -1,6 +1,10 @@
 #ifndef TESTCLIENT_H
 #define TESTCLIENT_H
 
+#include <QSet>
+#include <QMutex>
+#include <QElapsedTimer>
+
 #include "SlipProtocol.h"
 #include "PortManager.h"
 #include "JLinkManager.h"
@@ -8,6 +12,8 @@
 #include "SessionManager.h"
 #include "Logger.h"
 #include "RailtestClient.h"
+#include "CommandBatch.h"
+#include "RunningStats.h"
 
 class TestClient : public QObject
 {
@@ -15,6 +21,10 @@ class TestClient : public QObject
 
 public:
 
+    // Railtest runs at this rate after every DUT start.
+    static constexpr int DEFAULT_RAILTEST_BAUD = 115200;
+
+    static constexpr int DUT_SLOTS = 3;
 
     enum DutState {inactive, untested, tested, warning};
 
@@ -27,8 +37,6 @@ public:
     void setPort(const QString& portName);
     void open();
 
-    QMap<int, Dut> getDuts() {return _duts;}
-
 public slots:
 
     QStringList availiblePorts() const;
@@ -39,20 +47,20 @@ public slots:
     bool isActive() const; //True, if at least one DUT connected
     bool isConnected() const {return _isConnected;}
 
-    int dutsCount() const {return _duts.size();}
-    Dut dut(int slot) const {return _duts[slot];}
+    int dutsCount() const {return DUT_SLOTS;}
+    Dut dut(int slot) const {return _duts[slotIndex(slot)];}
     void setCurrentSlot(int slot) {_currentSlot = slot;}
 
     void setDutProperty(int slot, const QString& property, const QVariant& value);
     QVariant dutProperty(int slot, const QString& property);
 
-    int dutNo(int slot) const {return _duts[slot]["no"].toInt();}
+    int dutNo(int slot) const {return _duts[slotIndex(slot)].no;}
 
-    int dutState(int slot) const {return _duts[slot]["state"].toInt();}
-    void setDutState(int slot, int state) {_duts[slot]["state"] = state;}
+    int dutState(int slot) const {return _duts[slotIndex(slot)].state;}
+    void setDutState(int slot, int state) {_duts[slotIndex(slot)].state = state;}
 
-    bool isDutAvailable(int slot) const {return _duts[slot]["state"].toBool();}
-    bool isDutChecked(int slot) const {return _duts[slot]["checked"].toBool();}
+    bool isDutAvailable(int slot) const {return _duts[slotIndex(slot)].isAvailable();}
+    bool isDutChecked(int slot) const {return _duts[slotIndex(slot)].checked;}
     void setDutChecked(int no, bool checked);
 
     void addDutError(int slot, QString error);
@@ -62,8 +70,12 @@ public slots:
 
     void resetDut(int slot);
 
+    // Sends the pending DUT changes now instead of on the next event loop pass, e.g. at the end of a test step.
+    void flushDutChanges();
+
     //SLIP commands
 
+    // The board's power and SWD mux state is tracked, a switch to the current state is not sent.
     int switchSWD(int slot);
     int powerOn(int slot);
     int powerOff(int slot);
@@ -80,16 +92,77 @@ public slots:
     int read3V();
     int readTemperature();
 
+    // Powers the slot on. Waits TestBoard/powerSettleTime only when the slot was actually off
+    // and is still settling, so calling it before every step costs nothing once the DUT runs.
+    int ensurePowered(int slot);
+    bool isPowered(int slot) const {return _power[slotIndex(slot)] == PowerOn;}
+
+    // Forgets the tracked power and SWD state, the next switches are sent unconditionally.
+    void resetSwitchState();
+
+    // Commands added to the returned batch go out together on submit(), see CommandBatch.
+    CommandBatch *batch();
+
+    // Take up to count readings, pipelined when interval is 0 or one every interval ms otherwise.
+    // A positive tolerance stops early once the last few readings lie within it. Returns
+    // {count, min, max, mean, stddev} of the valid readings, plus errors (failed reads),
+    // last, converged and settled (the mean of the readings that converged, else last).
+    QVariantMap sampleAIN(int slot, int AIN, int gain, int count, int interval = 0, int tolerance = 0);
+    QVariantMap sampleCSA(int gain, int count, int interval = 0, int tolerance = 0);
+    QVariantMap sampleDinADC(int slot, int DIN, int count, int interval = 0, int tolerance = 0);
+
+    // MB_CONFIG_DUT_DEBUG, the board's UART towards the DUT. Parity 0 - none, 1 - even, 2 - odd.
+    int configDutDebug(int slot, int baudRate, int bits = 8, int parity = 0, int stopBits = 1);
+
+    // Moves the DUT and its board channel to the fastest of Railtest/baudRates that passes
+    // Railtest/probeCommand, once railtest runs. Returns the rate in use. A railtest exchange
+    // that fails at a raised rate drops the slot back to 115200 and is retried once.
+    int negotiateRailtestBaud(int slot);
+    int railtestBaud(int slot) const {return _railtestBaud[slotIndex(slot)];}
+
+    // Runs cmd count times, returns {baud, commands, replies, bytes, msecs, commandsPerSecond, bytesPerSecond}.
+    QVariantMap benchmarkRailtest(int slot, const QByteArray &cmd, int count);
+
     QStringList railtestCommand(int channel, const QByteArray &cmd);
+    QVariantMap railtestCommands(const QVariantList &slotList, const QByteArray &cmd);
+    QVariantMap railtestReplies(const QVariantList &slotList, const QByteArray &cmd);
+
+    // railtestCommands()/railtestReplies() without blocking in between, for scheduler tasks:
+    // post, wait for railtestReplied() until nothing is pending, then take the responses.
+    void postRailtestCommands(const QVariantList &slotList, const QByteArray &cmd);
+    bool isRailtestPending() const;
+    QVariantMap takeRailtestResponses(bool parsed);
     void testRadio(int slot, QString RfModuleId, int channel, int power, int minRSSI, int maxRSSI, int count);
 
+    // Parallel radio test, see GeneralCommands.testRadioParallel. The DUT sends packets every
+    // period ms with marker at payload octet markerOffset, the reference radio sorts them by it.
+    bool prepareRadioTx(int slot, int channel, int power, int period, int markerOffset = 0, int marker = -1);
+    bool startRadioTx(int slot, int count);
+
+    // Pass/fail of the radio test from {count, mean, stddev} of the received packets' RSSI.
+    bool checkRadio(int slot, int power, int count, int minRSSI, const QVariantMap &packets);
+
+    // The ReferenceRadio session of the module, for the sequences.
+    QObject *referenceRadio(const QString &moduleId);
+
     void setTimeout(int value) {_portManager.setTimeout(value);}
+    void setAdaptiveTimeouts(bool enabled) {_portManager.setAdaptiveTimeouts(enabled);}
+
+    QVariantMap latencyStatistics() const {return _portManager.latencyStatistics();}
+    void logLatencyStatistics();
 
 signals:
 
     void responseRecieved(QStringList response);
 
-    void dutChanged(Dut);
+    // MB_ASYNC_EVENT from the measuring board, MB_EVENT_* code.
+    void boardEvent(int code);
+
+    // The reply to a posted railtest command is complete.
+    void railtestReplied(int slot);
+
+    // DUTs written since the last notification, at most one entry per slot.
+    void dutsChanged(DutChanges changes);
     void dutFullyTested(Dut);
     void slotFullyTested(int);
     void commandSequenceStarted();
@@ -102,20 +175,66 @@ private slots:
 
 private:
 
+    // Validates, encodes and sends one MB_COMMAND_TABLE command, returns its result code.
+    template <typename Command, typename... Values>
+    int boardCommand(Values... values);
+
+    // The overload for commands without arguments, sent as frames encoded at compile time.
+    template <typename Command>
+    int boardCommand();
+
+    template <typename Command, typename... Values>
+    QVariantMap sampleBoard(int count, int interval, int tolerance, Values... values);
+
+    QMap<QString, QString> simulatorPorts() const;
+    void openPort(const QString &portName);
+
+    bool switchRailtestBaud(int slot, int baudRate);
+    void restoreRailtestBaud(int slot);
+    bool probeRailtest(int slot);
+    QList<int> failedRaisedSlots(const QList<int> &slotList, const QSet<int> &replied, int linkErrors);
+
+    // Commands of postRailtestCommands() per slot, and _linkErrors when they went out.
+    QMap<int, QByteArray> _postedRailtest;
+    int _postedLinkErrors = 0;
+
     PortManager _portManager;
+    CommandBatch _batch;
     int _no;
     QSharedPointer<QSettings> _settings;
     QSharedPointer<Logger> _logger;
 
-    QMap<int, Dut> _duts;
+    // Slots 1 to DUT_SLOTS; an invalid slot number from a script lands on the unused entry 0.
+    static int slotIndex(int slot) {return slot >= 1 && slot <= DUT_SLOTS ? slot : 0;}
+    Dut _duts[DUT_SLOTS + 1];
+
+    // Collects DUT writes into one dutsChanged per event loop pass.
+    void markDutChanged(int slot, quint32 fields);
+    QMutex _dutChangesMutex;
+    quint32 _dutChanges[DUT_SLOTS + 1] = {};
+    bool _dutChangesPosted = false;
 
     bool _isConnected = false;
     int _currentSlot = 0;
 
-    int _rfRSSI;
-    int _rfCount;
+    // Power and SWD mux state as last confirmed by the board.
+    enum PowerState {PowerUnknown, PowerOff, PowerOn};
+    void trackSwitch(int type, int slot, bool on, int result);
+    void onBatchSubmitted(const QList<QByteArray> &packets, const QVariantList &results);
+    PowerState _power[DUT_SLOTS + 1] = {};
+    QElapsedTimer _poweredSince[DUT_SLOTS + 1];
+    int _swdSlot = 0;
+
+    // RSSI of the reference module's packets during testRadio.
+    RunningStats _rssi;
+    Waiter _rfWaiter;
+    bool _rfTxEnded = false;
+
+    int _railtestBaud[DUT_SLOTS + 1] = {0, DEFAULT_RAILTEST_BAUD, DEFAULT_RAILTEST_BAUD, DEFAULT_RAILTEST_BAUD};
+    QSet<int> _failedBauds[DUT_SLOTS + 1];
 
-    QVector<int> _rssiValues;
+    // MB_EVENT_SLIP_ERROR count, an error during a railtest exchange at a raised rate fails it.
+    int _linkErrors = 0;
 };
 
 #endif // TESTCLIENT_H
@@ -124,8 +124,19 @@ void TestFixtureWidget::reset()
     }
 }
 
-void TestFixtureWidget::refreshButtonState(Dut dut)
+void TestFixtureWidget::refreshButtonStates(const DutChanges &changes)
 {
-    _buttons.at(dut["no"].toInt() - 1)->setButtonState(dut["state"].toInt());
-    _buttons.at(dut["no"].toInt() - 1)->setChecked(dut["checked"].toBool());
+    for (auto & change : changes)
+    {
+        auto button = _buttons.value(change.dut.no - 1);
+
+        if (!button)
+            continue;
+
+        if (change.fields & DutStateField)
+            button->setButtonState(change.dut.state);
+
+        if (change.fields & DutCheckedField)
+            button->setChecked(change.dut.checked);
+    }
 }
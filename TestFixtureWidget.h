@@ -21,7 +21,7 @@ public slots:
 
     void refreshButtonsState();
     void reset();
-    void refreshButtonState(Dut dut);
+    void refreshButtonStates(const DutChanges &changes);
 
 signals:
 
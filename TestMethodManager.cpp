@@ -2,11 +2,12 @@
 
 #include <QDebug>
 
-TestMethodManager::TestMethodManager(const QSharedPointer<QSettings> &settings, QObject *parent) : QObject(parent), _settings(settings),  _scriptEngine(this)
+TestMethodManager::TestMethodManager(const QSharedPointer<QSettings> &settings, QObject *parent) : QObject(parent), _settings(settings),  _scriptEngine(this), _scheduler(&_scriptEngine, this)
 {
     _scriptEngine.installExtensions(QJSEngine::ConsoleExtension);
 
     _scriptEngine.globalObject().setProperty("methodManager", _scriptEngine.newQObject(this));
+    _scriptEngine.globalObject().setProperty("scheduler", _scriptEngine.newQObject(&_scheduler));
     evaluateScriptsFromDirectory(settings->value("workDirectory").toString() + "/sequences");
 }
 
@@ -57,6 +58,7 @@ void TestMethodManager::runTestFunction(const QString &name)
         if(i.functionName == name)
         {
             i.function.call();
+            _scheduler.dropFinished();
             break;
         }
     }
@@ -8,6 +8,7 @@
 #include <QJSValue>
 
 #include "Logger.h"
+#include "TaskScheduler.h"
 
 class TestMethodManager : public QObject
 {
@@ -31,7 +32,12 @@ public:
 
     TestMethodManager(const QSharedPointer<QSettings> &settings, QObject *parent = nullptr);
 
-    void setLogger(const QSharedPointer<Logger>& logger) {_logger = logger; _scriptEngine.globalObject().setProperty("logger", _scriptEngine.newQObject(_logger.get()));}
+    void setLogger(const QSharedPointer<Logger>& logger)
+    {
+        _logger = logger;
+        _scheduler.setLogger(logger);
+        _scriptEngine.globalObject().setProperty("logger", _scriptEngine.newQObject(_logger.get()));
+    }
     QJSEngine* scriptEngine() {return &_scriptEngine;}
 
     Q_INVOKABLE void addMethod(const QString& name);
@@ -52,6 +58,7 @@ private:
 
     QSharedPointer<QSettings> _settings;
     QJSEngine _scriptEngine;
+    TaskScheduler _scheduler;
     QSharedPointer<Logger> _logger;
     QString _currentMethod;
     QMap<QString, TestMethod> _methods;
@@ -0,0 +1,94 @@
+#include "TrafficRecorder.h"
+
+#include <QtEndian>
+
+constexpr char TrafficRecorder::CAPTURE_MAGIC[6];
+constexpr quint16 TrafficRecorder::CAPTURE_VERSION;
+
+TrafficRecorder *TrafficRecorder::instance()
+{
+    static TrafficRecorder recorder;
+
+    return &recorder;
+}
+
+bool TrafficRecorder::start(const QString &fileName)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_file.isOpen())
+        _file.close();
+
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    quint16 version = qToLittleEndian(CAPTURE_VERSION);
+
+    _file.write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    _file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+
+    _announcedPorts.clear();
+    _clock.start();
+    _recording = true;
+
+    return true;
+}
+
+void TrafficRecorder::stop()
+{
+    QMutexLocker locker(&_mutex);
+
+    _recording = false;
+    if (_file.isOpen())
+        _file.close();
+}
+
+quint16 TrafficRecorder::registerPort(const QString &name, RecordType kind)
+{
+    QMutexLocker locker(&_mutex);
+
+    auto it = _portIds.find(name);
+
+    if (it != _portIds.end())
+        return it.value();
+
+    quint16 id = _ports.size();
+
+    _portIds.insert(name, id);
+    _ports.append({name.toUtf8(), kind});
+
+    return id;
+}
+
+void TrafficRecorder::record(quint16 port, RecordType type, const char *data, int size)
+{
+    if (!isRecording() || size <= 0)
+        return;
+
+    QMutexLocker locker(&_mutex);
+
+    if (!_recording || port >= _ports.size())
+        return;
+
+    if (!_announcedPorts.contains(port))
+    {
+        _announcedPorts.insert(port);
+        writeRecord(port, _ports[port].kind, _ports[port].name.constData(), _ports[port].name.size());
+    }
+
+    writeRecord(port, type, data, size);
+}
+
+void TrafficRecorder::writeRecord(quint16 port, RecordType type, const char *data, int size)
+{
+    CaptureRecord record;
+
+    record.timestamp = qToLittleEndian(quint64(_clock.nsecsElapsed()));
+    record.port = qToLittleEndian(port);
+    record.type = type;
+    record.size = qToLittleEndian(quint32(size));
+
+    _file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    _file.write(data, size);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+
+#include <QFile>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+#include <QSet>
+
+// Records serial traffic of all ports into one binary capture file.
+//
+// The file starts with CAPTURE_MAGIC and a version, followed by records made of a
+// packed little endian CaptureRecord header and its data. Before its first data record
+// a port is announced by a port record carrying its name. Timestamps are monotonic
+// nanoseconds since the recording started. Ports are driven from several threads, so
+// writes are serialised by a mutex; record() is one atomic load when not recording.
+
+class TrafficRecorder
+{
+public:
+
+    enum RecordType : quint8 {SlipPort, TextPort, Sent, Received};
+
+#pragma pack (push, 1)
+    struct CaptureRecord
+    {
+        quint64 timestamp;
+        quint16 port;
+        quint8 type;
+        quint32 size;
+    };
+#pragma pack (pop)
+
+    static constexpr char CAPTURE_MAGIC[6] = {'F', 'T', 'A', 'C', 'A', 'P'};
+    static constexpr quint16 CAPTURE_VERSION = 1;
+
+    static TrafficRecorder *instance();
+
+    bool start(const QString &fileName);
+    void stop();
+    bool isRecording() const {return _recording.load(std::memory_order_relaxed);}
+
+    // Returns a stable id for the port name; kind is SlipPort or TextPort.
+    quint16 registerPort(const QString &name, RecordType kind);
+    void record(quint16 port, RecordType type, const char *data, int size);
+
+private:
+
+    TrafficRecorder() = default;
+
+    struct Port
+    {
+        QByteArray name;
+        RecordType kind;
+    };
+
+    void writeRecord(quint16 port, RecordType type, const char *data, int size);
+
+    std::atomic<bool> _recording {false};
+    QMutex _mutex;
+    QFile _file;
+    QElapsedTimer _clock;
+    QHash<QString, quint16> _portIds;
+    QVector<Port> _ports;
+    QSet<quint16> _announcedPorts;
+};
@@ -0,0 +1,204 @@
+#include "TrafficReplay.h"
+#include "RailtestReply.h"
+
+#include <QFile>
+#include <QMetaMethod>
+#include <QtEndian>
+
+#include <cstring>
+
+TrafficReplay::TrafficReplay(QObject *parent) : QObject(parent)
+{
+    _timer.setSingleShot(true);
+    _timer.setTimerType(Qt::PreciseTimer);
+    connect(&_timer, &QTimer::timeout, this, &TrafficReplay::replayDue);
+}
+
+bool TrafficReplay::load(const QString &fileName)
+{
+    QFile file(fileName);
+
+    stop();
+    _records.clear();
+    _ports.clear();
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        _errorString = file.errorString();
+        return false;
+    }
+
+    _capture = file.readAll();
+
+    const int headerSize = sizeof(TrafficRecorder::CAPTURE_MAGIC) + sizeof(quint16);
+
+    if (_capture.size() < headerSize || memcmp(_capture.constData(), TrafficRecorder::CAPTURE_MAGIC, sizeof(TrafficRecorder::CAPTURE_MAGIC)))
+    {
+        _errorString = "Not a traffic capture file.";
+        return false;
+    }
+
+    if (qFromLittleEndian<quint16>(_capture.constData() + sizeof(TrafficRecorder::CAPTURE_MAGIC)) != TrafficRecorder::CAPTURE_VERSION)
+    {
+        _errorString = "Unsupported traffic capture version.";
+        return false;
+    }
+
+    int offset = headerSize;
+
+    while (offset + (int)sizeof(TrafficRecorder::CaptureRecord) <= _capture.size())
+    {
+        TrafficRecorder::CaptureRecord header;
+
+        memcpy(&header, _capture.constData() + offset, sizeof(header));
+        offset += sizeof(header);
+
+        Record record;
+
+        record.timestamp = qint64(qFromLittleEndian(header.timestamp));
+        record.port = qFromLittleEndian(header.port);
+        record.type = TrafficRecorder::RecordType(header.type);
+        record.offset = offset;
+        record.size = int(qFromLittleEndian(header.size));
+
+        // A capture cut short by a crash ends with a partial record.
+        if (record.size < 0 || record.size > _capture.size() - offset)
+            break;
+
+        offset += record.size;
+
+        if (record.type == TrafficRecorder::SlipPort || record.type == TrafficRecorder::TextPort)
+        {
+            auto &port = _ports[record.port];
+
+            port.name = QString::fromUtf8(_capture.constData() + record.offset, record.size);
+            port.kind = record.type;
+            continue;
+        }
+
+        _records.append(record);
+    }
+
+    _errorString.clear();
+    return true;
+}
+
+void TrafficReplay::start()
+{
+    stop();
+
+    _statistics = Statistics();
+    _next = 0;
+
+    if (!_records.isEmpty())
+        _statistics.captureNsecs = _records.last().timestamp - _records.first().timestamp;
+
+    // Building signal payloads costs allocations, skip it when nobody listens.
+    _emitFrames = isSignalConnected(QMetaMethod::fromSignal(&TrafficReplay::frameDecoded));
+    _emitLines = isSignalConnected(QMetaMethod::fromSignal(&TrafficReplay::lineDecoded));
+    _emitData = isSignalConnected(QMetaMethod::fromSignal(&TrafficReplay::dataReplayed));
+
+    for (auto it = _ports.begin(); it != _ports.end(); ++it)
+    {
+        auto port = it.key();
+        auto &state = it.value();
+
+        state.lineBuffer.clear();
+
+        if (state.kind != TrafficRecorder::SlipPort)
+            continue;
+
+        state.decoder = QSharedPointer<SlipDecoder>::create();
+        state.decoder->setFrameHandler([this, port](quint8 channel, const char *payload, int size)
+        {
+            ++_statistics.frames;
+            if (_emitFrames)
+                emit frameDecoded(port, channel, QByteArray(payload, size));
+        });
+        state.decoder->setErrorHandler([this](SlipDecoder::Error)
+        {
+            ++_statistics.decodeErrors;
+        });
+    }
+
+    _clock.start();
+    _timer.start(0);
+}
+
+void TrafficReplay::stop()
+{
+    _timer.stop();
+}
+
+void TrafficReplay::replayDue()
+{
+    if (_speed == 0)
+    {
+        for (; _next < _records.size(); ++_next)
+            replayRecord(_records[_next]);
+    }
+
+    else
+    {
+        const qint64 start = _records.isEmpty() ? 0 : _records.first().timestamp;
+        const qint64 now = start + qint64(_clock.nsecsElapsed() * _speed);
+
+        for (; _next < _records.size() && _records[_next].timestamp <= now; ++_next)
+            replayRecord(_records[_next]);
+
+        if (_next < _records.size())
+        {
+            _timer.start(int((_records[_next].timestamp - now) / _speed / 1000000));
+            return;
+        }
+    }
+
+    _statistics.replayNsecs = _clock.nsecsElapsed();
+    emit finished();
+}
+
+void TrafficReplay::replayRecord(const Record &record)
+{
+    const char *data = _capture.constData() + record.offset;
+    auto &port = _ports[record.port];
+
+    ++_statistics.records;
+
+    if (_emitData)
+        emit dataReplayed(record.port, record.type == TrafficRecorder::Sent, QByteArray(data, record.size));
+
+    if (record.type == TrafficRecorder::Sent)
+    {
+        _statistics.bytesSent += record.size;
+        return;
+    }
+
+    _statistics.bytesReceived += record.size;
+
+    if (port.decoder)
+        port.decoder->feed(data, record.size);
+    else
+        feedText(record.port, port, data, record.size);
+}
+
+void TrafficReplay::feedText(quint16 port, Port &state, const char *data, int size)
+{
+    state.lineBuffer.append(data, size);
+
+    int from = 0;
+    int idx;
+
+    while ((idx = state.lineBuffer.indexOf("\r\n", from)) != -1)
+    {
+        auto line = QByteArray::fromRawData(state.lineBuffer.constData() + from, idx - from);
+
+        RailtestReply::parseLine(line);
+        ++_statistics.lines;
+        if (_emitLines)
+            emit lineDecoded(port, QByteArray(line.constData(), line.size()));
+
+        from = idx + 2;
+    }
+
+    state.lineBuffer.remove(0, from);
+}
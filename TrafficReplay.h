@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
+#include <QMap>
+
+#include "TrafficRecorder.h"
+#include "SlipDecoder.h"
+
+// Plays a TrafficRecorder capture back through the receive decoders.
+//
+// Received data of SLIP ports goes through a SlipDecoder, that of railtest text ports
+// is split into lines and parsed as RailtestReply records, the way the live clients do
+// it. Records are played at their captured pace scaled by the speed factor; a speed of
+// 0 plays them back to back, which measures the decoders alone.
+
+class TrafficReplay : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    struct Statistics
+    {
+        quint64 records = 0;
+        quint64 bytesSent = 0;
+        quint64 bytesReceived = 0;
+        quint64 frames = 0;
+        quint64 lines = 0;
+        quint64 decodeErrors = 0;
+        qint64 captureNsecs = 0;
+        qint64 replayNsecs = 0;
+    };
+
+    explicit TrafficReplay(QObject *parent = nullptr);
+
+    bool load(const QString &fileName);
+    QString errorString() const {return _errorString;}
+
+    void setSpeed(double speed) {_speed = qMax(0.0, speed);}
+    double speed() const {return _speed;}
+
+    QString portName(quint16 port) const {return _ports.value(port).name;}
+    const Statistics &statistics() const {return _statistics;}
+
+public slots:
+
+    void start();
+    void stop();
+
+signals:
+
+    void dataReplayed(quint16 port, bool sent, QByteArray data);
+    void frameDecoded(quint16 port, quint8 channel, QByteArray payload);
+    void lineDecoded(quint16 port, QByteArray line);
+    void finished();
+
+private slots:
+
+    void replayDue();
+
+private:
+
+    struct Port
+    {
+        QString name;
+        TrafficRecorder::RecordType kind = TrafficRecorder::SlipPort;
+        QSharedPointer<SlipDecoder> decoder;
+        QByteArray lineBuffer;
+    };
+
+    struct Record
+    {
+        qint64 timestamp;
+        quint16 port;
+        TrafficRecorder::RecordType type;
+        int offset;
+        int size;
+    };
+
+    void replayRecord(const Record &record);
+    void feedText(quint16 port, Port &state, const char *data, int size);
+
+    QByteArray _capture;
+    QVector<Record> _records;
+    QMap<quint16, Port> _ports;
+    QString _errorString;
+
+    double _speed = 1.0;
+    int _next = 0;
+    QElapsedTimer _clock;
+    QTimer _timer;
+    bool _emitFrames = false;
+    bool _emitLines = false;
+    bool _emitData = false;
+    Statistics _statistics;
+};
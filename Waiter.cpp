@@ -0,0 +1,51 @@
+#include "Waiter.h"
+
+#include <QEventLoop>
+#include <QDeadlineTimer>
+#include <QTimer>
+
+bool Waiter::wait(const std::function<bool()> &condition, int timeout)
+{
+    auto deadline = timeout < 0 ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(timeout, Qt::PreciseTimer);
+
+    while (!condition())
+    {
+        if (deadline.hasExpired())
+            return false;
+
+        QEventLoop loop;
+        QTimer timer;
+
+        if (!deadline.isForever())
+        {
+            timer.setSingleShot(true);
+            timer.setTimerType(Qt::PreciseTimer);
+            QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+            timer.start(int(deadline.remainingTime()));
+        }
+
+        _loops.push_back(&loop);
+        loop.exec();
+        _loops.removeOne(&loop);
+        ++_wakeups;
+    }
+
+    return true;
+}
+
+void Waiter::wake()
+{
+    for (auto loop : _loops)
+        loop->quit();
+}
+
+void Waiter::sleep(int msec)
+{
+    if (msec <= 0)
+        return;
+
+    QEventLoop loop;
+
+    QTimer::singleShot(msec, Qt::PreciseTimer, &loop, &QEventLoop::quit);
+    loop.exec();
+}
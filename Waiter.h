@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+
+#include <QtGlobal>
+#include <QList>
+
+class QEventLoop;
+
+// Blocks the calling thread until a condition holds or a monotonic deadline expires.
+//
+// The thread sleeps in a local event loop instead of spinning on processEvents(),
+// so an idle wait costs no CPU: it wakes up once at its deadline, or whenever the
+// code that changes the condition calls wake(). Events of the thread are still
+// dispatched while waiting, which is how serial replies get in.
+
+class Waiter
+{
+public:
+
+    // Returns the final value of the condition. A negative timeout waits forever.
+    bool wait(const std::function<bool()> &condition, int timeout);
+    void wake();
+
+    // Number of times a wait went back to check its condition, for profiling.
+    quint64 wakeups() const {return _wakeups;}
+
+    static void sleep(int msec);
+
+private:
+
+    QList<QEventLoop*> _loops;
+    quint64 _wakeups = 0;
+};
@@ -0,0 +1,190 @@
+#include "CrcCcitt.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Checks crcCcitt() against the per-byte lookup table SlipDecoder used before. With
+// --benchmark it also measures the throughput of both on a 1 MiB block.
+
+static const quint16 _crc_ccitt_lut[] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7, 0x8108,
+    0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef, 0x1231, 0x0210,
+    0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6, 0x9339, 0x8318, 0xb37b,
+    0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de, 0x2462, 0x3443, 0x0420, 0x1401,
+    0x64e6, 0x74c7, 0x44a4, 0x5485, 0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee,
+    0xf5cf, 0xc5ac, 0xd58d, 0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6,
+    0x5695, 0x46b4, 0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d,
+    0xc7bc, 0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b, 0x5af5,
+    0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12, 0xdbfd, 0xcbdc,
+    0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a, 0x6ca6, 0x7c87, 0x4ce4,
+    0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41, 0xedae, 0xfd8f, 0xcdec, 0xddcd,
+    0xad2a, 0xbd0b, 0x8d68, 0x9d49, 0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13,
+    0x2e32, 0x1e51, 0x0e70, 0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a,
+    0x9f59, 0x8f78, 0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e,
+    0xe16f, 0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e, 0x02b1,
+    0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256, 0xb5ea, 0xa5cb,
+    0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d, 0x34e2, 0x24c3, 0x14a0,
+    0x0481, 0x7466, 0x6447, 0x5424, 0x4405, 0xa7db, 0xb7fa, 0x8799, 0x97b8,
+    0xe75f, 0xf77e, 0xc71d, 0xd73c, 0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657,
+    0x7676, 0x4615, 0x5634, 0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9,
+    0xb98a, 0xa9ab, 0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882,
+    0x28a3, 0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92, 0xfd2e,
+    0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9, 0x7c26, 0x6c07,
+    0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1, 0xef1f, 0xff3e, 0xcf5d,
+    0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8, 0x6e17, 0x7e36, 0x4e55, 0x5e74,
+    0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
+};
+
+static quint16 referenceCrc(quint16 crc, const quint8 *data, int size)
+{
+    for (int i = 0; i < size; ++i)
+        crc = _crc_ccitt_lut[data[i] ^ (crc >> 8)] ^ quint16(crc << 8);
+
+    return crc;
+}
+
+static constexpr int MAX_SIZE = 4096;
+static constexpr int RANDOM_CASES = 20000;
+static constexpr int BENCHMARK_SIZE = 1 << 20;
+static constexpr int BENCHMARK_ROUNDS = 64;
+
+static int compare(const std::vector<quint8> &buffer, int offset, int size, quint16 init)
+{
+    auto data = buffer.data() + offset;
+    auto expected = referenceCrc(init, data, size);
+    auto actual = crcCcitt(init, data, size);
+
+    if (actual == expected)
+        return 0;
+
+    std::printf("FAIL offset %d size %d init 0x%04x: 0x%04x, expected 0x%04x\n", offset, size, init, actual, expected);
+    return 1;
+}
+
+static int testKnownValues()
+{
+    const char check[] = "123456789";
+    int failures = 0;
+
+    // CRC-16/CCITT-FALSE check value.
+    if (crcCcitt(CRC_CCITT_INIT, check, 9) != 0x29B1)
+    {
+        std::printf("FAIL check value: 0x%04x, expected 0x29b1\n", crcCcitt(CRC_CCITT_INIT, check, 9));
+        ++failures;
+    }
+
+    if (crcCcitt(0x1234, check, 0) != 0x1234)
+    {
+        std::printf("FAIL empty block does not keep the running value\n");
+        ++failures;
+    }
+
+    return failures;
+}
+
+static int testRandom(std::mt19937 &random)
+{
+    std::vector<quint8> buffer(MAX_SIZE + 16);
+    std::uniform_int_distribution<int> byte(0, 255), offset(0, 15), size(0, MAX_SIZE), init(0, 0xFFFF);
+    int failures = 0;
+
+    for (auto & value : buffer)
+        value = quint8(byte(random));
+
+    // Every size around the kernel block boundaries, at each alignment.
+    for (int n = 0; n <= 512; ++n)
+    {
+        for (int start = 0; start < 16; ++start)
+            failures += compare(buffer, start, n, CRC_CCITT_INIT);
+    }
+
+    for (int i = 0; i < RANDOM_CASES && failures < 10; ++i)
+    {
+        if (i % 64 == 0)
+        {
+            for (auto & value : buffer)
+                value = quint8(byte(random));
+        }
+
+        failures += compare(buffer, offset(random), size(random), quint16(init(random)));
+    }
+
+    // A message split in pieces gives the same CRC as in one go.
+    for (int i = 0; i < 1000 && failures < 10; ++i)
+    {
+        int total = size(random);
+        int split = std::uniform_int_distribution<int>(0, total)(random);
+        auto whole = crcCcitt(CRC_CCITT_INIT, buffer.data(), total);
+        auto pieces = crcCcitt(crcCcitt(CRC_CCITT_INIT, buffer.data(), split), buffer.data() + split, total - split);
+
+        if (whole != pieces)
+        {
+            std::printf("FAIL split %d of %d: 0x%04x, expected 0x%04x\n", split, total, pieces, whole);
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+// Keeps the measured calls from being optimised away.
+static volatile quint16 benchmarkSink;
+
+template <typename Crc>
+static double throughput(const std::vector<quint8> &buffer, Crc crc)
+{
+    quint16 sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < BENCHMARK_ROUNDS; ++i)
+        sink ^= crc(quint16(CRC_CCITT_INIT ^ i), buffer.data(), int(buffer.size()));
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    benchmarkSink = sink;
+
+    return double(buffer.size()) * BENCHMARK_ROUNDS / elapsed.count() / 1e9;
+}
+
+static void benchmark(std::mt19937 &random)
+{
+    std::vector<quint8> buffer(BENCHMARK_SIZE);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (auto & value : buffer)
+        value = quint8(byte(random));
+
+    double table = throughput(buffer, referenceCrc);
+    double current = throughput(buffer, [](quint16 crc, const quint8 *data, int size) {return crcCcitt(crc, data, size);});
+
+    std::printf("Per-byte table: %.2f GB/s\n", table);
+    std::printf("crcCcitt (%s): %.2f GB/s\n", crcCcittImplementation(), current);
+}
+
+int main(int argc, char *argv[])
+{
+    std::mt19937 random(20240601);
+    int failures = testKnownValues() + testRandom(random);
+
+    if (failures)
+    {
+        std::printf("%d failures\n", failures);
+        return 1;
+    }
+
+    std::printf("crcCcitt matches the per-byte table.\n");
+
+    // The benchmark is skipped when run as a test.
+    if (argc < 2 || std::strcmp(argv[1], "--benchmark") != 0)
+        return 0;
+
+    benchmark(random);
+    return 0;
+}
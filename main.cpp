@@ -1,6 +1,37 @@
 #include "MainWindow.h"
+#include "TrafficReplay.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+// Plays a traffic capture back through the decoders and prints the throughput.
+static int replayCapture(const QString &fileName, double speed)
+{
+    QTextStream out(stdout);
+    TrafficReplay replay;
+
+    if (!replay.load(fileName))
+    {
+        out << "Cannot load " << fileName << ": " << replay.errorString() << "\n";
+        return 1;
+    }
+
+    replay.setSpeed(speed);
+    QObject::connect(&replay, &TrafficReplay::finished, qApp, &QCoreApplication::quit);
+    replay.start();
+    qApp->exec();
+
+    auto &stats = replay.statistics();
+    double seconds = qMax<qint64>(1, stats.replayNsecs) / 1e9;
+
+    out << "Records: " << stats.records << ", sent: " << stats.bytesSent << " B, received: " << stats.bytesReceived << " B" << "\n";
+    out << "SLIP frames: " << stats.frames << ", railtest lines: " << stats.lines << ", decode errors: " << stats.decodeErrors << "\n";
+    out << "Capture length: " << stats.captureNsecs / 1e9 << " s, replayed in " << seconds << " s" << "\n";
+    out << "Throughput: " << stats.bytesReceived / seconds / 1e6 << " MB/s, " << stats.frames / seconds << " frames/s" << "\n";
+
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
@@ -10,6 +41,18 @@ int main(int argc, char *argv[])
     a.setOrganizationName("Capelon AB");
     a.setApplicationName("CapelonTestStation");
 
+    QCommandLineParser parser;
+    QCommandLineOption replayOption("replay", "Replay a serial traffic capture and exit.", "file");
+    QCommandLineOption speedOption("speed", "Replay speed factor, 0 for unbounded.", "factor", "1");
+
+    parser.addHelpOption();
+    parser.addOption(replayOption);
+    parser.addOption(speedOption);
+    parser.process(a);
+
+    if (parser.isSet(replayOption))
+        return replayCapture(parser.value(replayOption), parser.value(speedOption).toDouble());
+
     MainWindow w;
     w.setWindowTitle("Capelon Test Station 0.6.27");
     w.setFixedSize(1200, 900);
@@ -1,62 +1,43 @@
 #include "portmanager.h"
+#include "CrcCcitt.h"
 
 #include <QtEndian>
-#include <QCoreApplication>
+#include <algorithm>
+#include <limits>
 
 #include <QDebug>
 
-static constexpr char
-    END_SLIP_OCTET  = 0xC0,
-    END_SUBS_OCTET  = 0xDC,
-    ESC_SLIP_OCTET  = 0xDB,
-    ESC_SUBS_OCTET  = 0xDD;
-
-static constexpr int MIN_FRAME_SIZE = sizeof(quint8) + sizeof(quint16) + 1;
-
-static const quint16 _crc_ccitt_lut[] = {
-    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7, 0x8108,
-    0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef, 0x1231, 0x0210,
-    0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6, 0x9339, 0x8318, 0xb37b,
-    0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de, 0x2462, 0x3443, 0x0420, 0x1401,
-    0x64e6, 0x74c7, 0x44a4, 0x5485, 0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee,
-    0xf5cf, 0xc5ac, 0xd58d, 0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6,
-    0x5695, 0x46b4, 0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d,
-    0xc7bc, 0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
-    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b, 0x5af5,
-    0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12, 0xdbfd, 0xcbdc,
-    0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a, 0x6ca6, 0x7c87, 0x4ce4,
-    0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41, 0xedae, 0xfd8f, 0xcdec, 0xddcd,
-    0xad2a, 0xbd0b, 0x8d68, 0x9d49, 0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13,
-    0x2e32, 0x1e51, 0x0e70, 0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a,
-    0x9f59, 0x8f78, 0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e,
-    0xe16f, 0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
-    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e, 0x02b1,
-    0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256, 0xb5ea, 0xa5cb,
-    0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d, 0x34e2, 0x24c3, 0x14a0,
-    0x0481, 0x7466, 0x6447, 0x5424, 0x4405, 0xa7db, 0xb7fa, 0x8799, 0x97b8,
-    0xe75f, 0xf77e, 0xc71d, 0xd73c, 0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657,
-    0x7676, 0x4615, 0x5634, 0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9,
-    0xb98a, 0xa9ab, 0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882,
-    0x28a3, 0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
-    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92, 0xfd2e,
-    0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9, 0x7c26, 0x6c07,
-    0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1, 0xef1f, 0xff3e, 0xcf5d,
-    0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8, 0x6e17, 0x7e36, 0x4e55, 0x5e74,
-    0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
-};
+// Adaptive timeouts need this many replies of a command before replacing the configured timeout.
+static constexpr int ADAPTIVE_TIMEOUT_MIN_SAMPLES = 20;
+
+// An adaptive timeout is twice the 99th latency percentile, and at least this much above it.
+static constexpr int ADAPTIVE_TIMEOUT_MIN_MARGIN = 100;
+
+// A latency histogram is aged each time it holds this many samples, so it follows a latency that changes.
+static constexpr quint64 ADAPTIVE_TIMEOUT_WINDOW = 200;
+
+// Railtest latency is kept per command line; lines with few samples are dropped beyond this many.
+static constexpr int RAILTEST_LATENCY_MAX_COMMANDS = 64;
+
+// Railtest frames are held back this long after MB_EVENT_DUTDBGTX_FULL, doubling while the events continue.
+static constexpr int RAILTEST_BACKOFF_MIN = 20;
+static constexpr int RAILTEST_BACKOFF_MAX = 640;
+
+// Railtest output collected for one command is dropped beyond this size, so a chatty DUT cannot exhaust memory.
+static constexpr int MAX_RAIL_REPLY_SIZE = 64 * 1024;
 
 static inline void _encodeSymbol(QByteArray &buffer, char ch) Q_DECL_NOTHROW
 {
     switch (ch)
     {
-        case END_SLIP_OCTET:
-            buffer.append(ESC_SLIP_OCTET);
-            buffer.append(END_SUBS_OCTET);
+        case SlipDecoder::END_OCTET:
+            buffer.append(SlipDecoder::ESC_OCTET);
+            buffer.append(SlipDecoder::END_SUBS_OCTET);
             break;
 
-        case ESC_SLIP_OCTET:
-            buffer.append(ESC_SLIP_OCTET);
-            buffer.append(ESC_SUBS_OCTET);
+        case SlipDecoder::ESC_OCTET:
+            buffer.append(SlipDecoder::ESC_OCTET);
+            buffer.append(SlipDecoder::ESC_SUBS_OCTET);
             break;
 
         default:
@@ -64,38 +45,55 @@ static inline void _encodeSymbol(QByteArray &buffer, char ch) Q_DECL_NOTHROW
     }
 }
 
-PortManager::PortManager(QObject *parent) : QObject(parent), _serial(this)
+PortManager::PortManager(QObject *parent) : QObject(parent), _worker(new SerialWorker), _commandTimer(this), _railtestBackoffTimer(this)
 {
-    connect(&_serial, &QSerialPort::readyRead, this, &PortManager::onSerialPortReadyRead);
-    connect(&_serial, &QSerialPort::errorOccurred, this, &PortManager::onSerialPortErrorOccurred);
+    _ioThread.setObjectName("Serial I/O thread");
+    _worker->moveToThread(&_ioThread);
+    connect(&_ioThread, &QThread::finished, _worker, &QObject::deleteLater);
+    connect(_worker, &SerialWorker::framesReceived, this, &PortManager::onFramesReceived);
+    connect(_worker, &SerialWorker::errorOccurred, this, &PortManager::onWorkerErrorOccurred);
+    _ioThread.start();
+
+    _commandTimer.setSingleShot(true);
+    connect(&_commandTimer, &QTimer::timeout, this, &PortManager::onCommandTimerTimeout);
+
+    _railtestBackoffTimer.setSingleShot(true);
+    connect(&_railtestBackoffTimer, &QTimer::timeout, this, &PortManager::onRailtestBackoffTimeout);
 }
 
-void PortManager::setPort(const QString &name, qint32 baudRate, QSerialPort::DataBits dataBits, QSerialPort::Parity parity, QSerialPort::StopBits stopBits, QSerialPort::FlowControl flowControl)
+PortManager::~PortManager()
 {
-    _serial.setPortName(name);
-
-    bool res = _serial.setBaudRate(baudRate)
-        && _serial.setDataBits(dataBits)
-        && _serial.setParity(parity)
-        && _serial.setStopBits(stopBits)
-        && _serial.setFlowControl(flowControl);
+    close();
+    _ioThread.quit();
+    _ioThread.wait();
+}
 
-    if (!res)
-        qDebug() << _serial.errorString();
+void PortManager::setPort(const QString &name, qint32 baudRate, QSerialPort::DataBits dataBits, QSerialPort::Parity parity, QSerialPort::StopBits stopBits, QSerialPort::FlowControl flowControl)
+{
+    _portName = name;
+    _baudRate = baudRate;
+    _dataBits = dataBits;
+    _parity = parity;
+    _stopBits = stopBits;
+    _flowControl = flowControl;
 }
 
 void PortManager::open()
 {
-    if (_serial.isOpen())
-    {
-        _serial.close();
-    }
+    bool opened = false;
 
-    if (!_serial.open(QSerialPort::ReadWrite))
-        qDebug() << "an error occures when opening serial port: " << _serial.errorString();
-    else
+    QMetaObject::invokeMethod(_worker, "open", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, opened),
+                              Q_ARG(QString, _portName), Q_ARG(int, _baudRate), Q_ARG(int, _dataBits),
+                              Q_ARG(int, _parity), Q_ARG(int, _stopBits), Q_ARG(int, _flowControl));
+
+    // The board on the port may be another one now.
+    _batchSupported = true;
+    _commandWindow = _maxCommandsInFlight;
+    _commandWindowCredit = 0;
+    _railtestBackoff = 0;
+
+    if (opened)
     {
-        _serial.readAll();
         _timeout = 1000;
         railtestCommand(1, " ");
         _timeout = 10000;
@@ -104,216 +102,713 @@ void PortManager::open()
 
 void PortManager::close()
 {
-    if (_serial.isOpen())
+    QMetaObject::invokeMethod(_worker, "close", Qt::BlockingQueuedConnection);
+
+    // Nothing will answer the commands still waiting for the board, complete them as timed out.
+    auto aborted = _commandsInFlight.values() + _queuedCommands;
+
+    _commandsInFlight.clear();
+    _queuedCommands.clear();
+    _commandTimer.stop();
+    _railtestBackoffTimer.stop();
+    _deferredRailtestFrames.clear();
+    _waiter.wake();
+
+    for (auto & command : aborted)
     {
-        _serial.flush();
-        _serial.close();
+        if (command.callback)
+            command.callback(command.sequence, QStringList());
+        else
+            _unclaimedResponses.insert(command.sequence, QStringList());
+
+        emit slipCommandFinished(command.sequence, QStringList());
     }
 }
 
 QStringList PortManager::slipCommand(int channel, const QByteArray &frame)
 {
-    _mode = slipMode;
-    _response.clear();
-    sendFrame(channel, frame);
+    auto response = waitSlipCommand(postSlipCommand(channel, frame));
 
-    if(_response.isEmpty())
+    if(response.isEmpty())
     {
         _logger->logDebug("Timeout for the response waiting.");
     }
-    emit responseRecieved(_response);
-    return _response;
+    emit responseRecieved(response);
+    return response;
 }
 
-QStringList PortManager::railtestCommand(int channel, const QByteArray &cmd)
+QStringList PortManager::slipCommand(const MbEncodedFrames &frames)
 {
-    if(channel > 3)
-        return QStringList();
-
-    _mode = railMode;
-    _railReply[channel].clear();
-    _response.clear();
-    _syncCommand = cmd;
-    _syncReplies.clear();
-    sendFrame(channel, cmd + "\r\n\r\n");
+    auto response = waitSlipCommand(postSlipCommand(frames));
 
-    if(_response.isEmpty())
+    if(response.isEmpty())
     {
         _logger->logDebug("Timeout for the response waiting.");
     }
-    emit responseRecieved(_response);
-    return _response;
+    emit responseRecieved(response);
+    return response;
+}
+
+QStringList PortManager::slipBatch(const QList<QByteArray> &packets)
+{
+    struct Batch
+    {
+        quint8 sequence;
+        int first;
+        int count;
+    };
+
+    QList<Batch> batches;
+
+    // Every batch goes out before the first result is awaited, so several can be on the wire.
+    for (int first = 0; first < packets.size();)
+    {
+        QByteArray frame(sizeof(MB_Packet_t), 0);
+        int count = 0;
+
+        while (first + count < packets.size() && count < MB_BATCH_MAX_COMMANDS &&
+               frame.size() + packets[first + count].size() <= (int)sizeof(MB_Packet_t) + 255)
+        {
+            frame += packets[first + count];
+            ++count;
+        }
+
+        // A packet too long for any batch still goes out on its own.
+        count = qMax(count, 1);
+
+        if (count == 1 || !_batchSupported)
+        {
+            for (int i = first; i < first + count; ++i)
+                batches.append({postSlipCommand(0, packets[i]), i, 1});
+        }
+
+        else
+        {
+            auto header = reinterpret_cast<MB_Packet_t*>(frame.data());
+
+            header->type = qToBigEndian<quint16>(MB_BATCH);
+            header->dataLen = quint8(frame.size() - sizeof(MB_Packet_t));
+            batches.append({postSlipCommand(0, frame), first, count});
+        }
+
+        first += count;
+    }
+
+    QStringList results;
+
+    for (auto & batch : batches)
+    {
+        auto response = waitSlipCommand(batch.sequence);
+
+        if (batch.count > 1 && response.size() == 1 && response[0].toInt() == MB_ERROR_INVALID_PACKET_TYPE)
+        {
+            if (_batchSupported)
+                _logger->logInfo(QString("Measuring board on %1 does not support command batches, sending commands one by one.").arg(_portName));
+            _batchSupported = false;
+
+            QList<quint8> sequences;
+
+            for (int i = batch.first; i < batch.first + batch.count; ++i)
+                sequences.append(postSlipCommand(0, packets[i]));
+
+            for (auto sequence : sequences)
+                results.append(waitSlipCommand(sequence).value(0));
+
+            continue;
+        }
+
+        if (response.size() != batch.count)
+        {
+            _logger->logDebug(response.isEmpty() ? QString("Timeout for the response waiting.")
+                                                 : QString("SLIP. Batch of %1 commands got %2 results.").arg(batch.count).arg(response.size()));
+            response.clear();
+            for (int i = 0; i < batch.count; ++i)
+                response.append(QString());
+        }
+
+        results += response;
+    }
+
+    emit responseRecieved(results);
+    return results;
+}
+
+quint8 PortManager::postSlipCommand(int channel, const QByteArray &frame, CommandCallback callback)
+{
+    SlipCommand command;
+
+    command.channel = channel;
+    command.frame = frame;
+    command.encodedFrames = nullptr;
+    command.callback = callback;
+
+    return postSlipCommand(command);
+}
+
+quint8 PortManager::postSlipCommand(const MbEncodedFrames &frames, CommandCallback callback)
+{
+    SlipCommand command;
+
+    command.channel = 0;
+    command.encodedFrames = &frames;
+    command.callback = callback;
+
+    return postSlipCommand(command);
+}
+
+quint8 PortManager::postSlipCommand(SlipCommand &command)
+{
+    command.sequence = nextSequence();
+
+    if (command.encodedFrames)
+        command.type = command.encodedFrames->type;
+    else if (command.frame.size() >= (int)sizeof(MB_Packet_t))
+        command.type = qFromBigEndian(reinterpret_cast<const MB_Packet_t*>(command.frame.constData())->type);
+    else
+        command.type = 0;
+
+    auto histogram = _slipLatency.find(command.type);
+
+    command.timeout = timeoutFor(histogram == _slipLatency.end() ? nullptr : &histogram.value());
+
+    if (command.frame.size() >= (int)sizeof(MB_Packet_t))
+        reinterpret_cast<MB_Packet_t*>(command.frame.data())->sequence = command.sequence;
+
+    _unclaimedResponses.remove(command.sequence);
+    _queuedCommands.enqueue(command);
+    sendQueuedCommands();
+
+    return command.sequence;
+}
+
+QStringList PortManager::waitSlipCommand(quint8 sequence)
+{
+    // Every posted command is completed either by its reply or by the command timer.
+    _waiter.wait([this, sequence]() {return !isSlipCommandPending(sequence);}, -1);
+
+    return _unclaimedResponses.take(sequence);
+}
+
+bool PortManager::isSlipCommandPending(quint8 sequence) const
+{
+    if (_commandsInFlight.contains(sequence))
+        return true;
+
+    for (auto & command : _queuedCommands)
+    {
+        if (command.sequence == sequence)
+            return true;
+    }
+
+    return false;
 }
 
-void PortManager::onSerialPortReadyRead()
+quint8 PortManager::nextSequence()
 {
-    switch (_mode)
+    // Sequence 0 is never used, so that a zeroed header cannot be mistaken for a reply.
+    for (int i = 0; i < 255; ++i)
     {
-    case idleMode:
-        _serial.readAll();
-        break;
+        if (++_sequence == 0)
+            _sequence = 1;
 
-    case slipMode:
-    case railMode:
-        processResponsePacket();
-        break;
+        if (!isSlipCommandPending(_sequence))
+            break;
     }
+
+    return _sequence;
 }
 
-void PortManager::onSerialPortErrorOccurred(QSerialPort::SerialPortError errorCode)
+void PortManager::sendQueuedCommands()
 {
-    if (errorCode != QSerialPort::NoError)
-        _logger->logError("Serial port error occurred " + QString().setNum(errorCode) + " on port " + _serial.portName());
+    while (!_queuedCommands.isEmpty() && _commandsInFlight.size() < _commandWindow)
+    {
+        auto command = _queuedCommands.dequeue();
+
+        command.timer.start();
+        _commandsInFlight.insert(command.sequence, command);
+
+        if (command.encodedFrames)
+            sendEncodedFrame(command.encodedFrames->frames[command.sequence]);
+        else
+            sendFrame(command.channel, command.frame);
+    }
+
+    restartCommandTimer();
 }
 
-void PortManager::processResponsePacket()
+void PortManager::finishSlipCommand(quint8 sequence, const QStringList &response)
 {
-    while (_serial.bytesAvailable())
+    auto it = _commandsInFlight.find(sequence);
+
+    if (it == _commandsInFlight.end())
     {
-        QByteArray buffer = _serial.readAll();
-        foreach (char ch, buffer)
+        _logger->logDebug(QString("SLIP. Unexpected result for sequence %1.").arg(sequence));
+        return;
+    }
+
+    auto callback = it->callback;
+
+    // Replies are sampled here, expired commands in onCommandTimerTimeout().
+    if (!response.isEmpty())
+    {
+        addLatency(_slipLatency[it->type], it->timer.nsecsElapsed() / 1000, false);
+
+        if (_commandWindow < _maxCommandsInFlight && ++_commandWindowCredit >= _commandWindow)
         {
-            if (ch == END_SLIP_OCTET)
-                if (_frameStarted)
-                {
-                    if (_recvBuffer.size() >= MIN_FRAME_SIZE)
-                    {
-                        decodeFrame();
-                        _frameStarted = false;
-                    }
-                    _recvBuffer.clear();
-                }
-                else
-                {
-                    _frameStarted = true;
-                    _recvBuffer.clear();
-                }
-            else
-                if (_frameStarted)
-                    _recvBuffer.append(ch);
+            ++_commandWindow;
+            _commandWindowCredit = 0;
         }
     }
+
+    _commandsInFlight.erase(it);
+    _waiter.wake();
+
+    // Refill the board queue before handing the result out, so the next command is already on the wire.
+    sendQueuedCommands();
+
+    if (callback)
+        callback(sequence, response);
+    else
+        _unclaimedResponses.insert(sequence, response);
+
+    emit slipCommandFinished(sequence, response);
+}
+
+void PortManager::restartCommandTimer()
+{
+    if (_commandsInFlight.isEmpty())
+    {
+        _commandTimer.stop();
+        return;
+    }
+
+    qint64 remaining = std::numeric_limits<qint64>::max();
+
+    for (auto & command : _commandsInFlight)
+        remaining = qMin(remaining, command.timeout - command.timer.elapsed());
+
+    _commandTimer.start(int(qMax<qint64>(0, remaining)));
 }
 
-void PortManager::decodeFrame() Q_DECL_NOTHROW
+void PortManager::onCommandQueueFull()
 {
-    QByteArray decodedBuffer;
-//    static QByteArray railReply;
+    _commandWindow = qMax(1, _commandWindow / 2);
+    _commandWindowCredit = 0;
+
+    // The board drops what it cannot queue, which is the latest commands sent. Those beyond
+    // the reduced window go back to the head of the queue. Board commands are idempotent, so
+    // resending one that did get through only repeats it; its extra reply is ignored.
+    auto inFlight = _commandsInFlight.values();
 
-    // Write unescaped buffer.
-    decodedBuffer.reserve(_recvBuffer.size());
-    for (int i = 0; i < _recvBuffer.size(); ++i)
+    std::sort(inFlight.begin(), inFlight.end(), [](const SlipCommand &a, const SlipCommand &b)
     {
-        char ch = _recvBuffer.at(i);
+        return a.timer.elapsed() < b.timer.elapsed();
+    });
 
-        if (ch == ESC_SLIP_OCTET)
-        {
-            ++i;
-            if (i >= _recvBuffer.size())
-            {
-                _logger->logError("SLIP. Decode frame. Unfinished escape sequence.");
-                return;
-            }
-            switch (_recvBuffer.at(i))
-            {
-                case END_SUBS_OCTET:
-                    decodedBuffer.append(END_SLIP_OCTET);
-                    break;
+    for (int i = 0; _commandsInFlight.size() > _commandWindow; ++i)
+    {
+        _commandsInFlight.remove(inFlight[i].sequence);
+        _queuedCommands.prepend(inFlight[i]);
+    }
 
-                case ESC_SUBS_OCTET:
-                    decodedBuffer.append(ESC_SLIP_OCTET);
-                    break;
+    _logger->logDebug(QString("SLIP. Board command queue full on %1, %2 commands in flight now, %3 queued.")
+                      .arg(_portName).arg(_commandWindow).arg(_queuedCommands.size()));
 
-                default:
-                    _logger->logError("SLIP. Decode frame. Invalid escape sequence.");
-                    return;
-            }
+    restartCommandTimer();
+}
+
+void PortManager::onDutDebugTxFull()
+{
+    _railtestBackoff = _railtestBackoff ? qMin(2 * _railtestBackoff, RAILTEST_BACKOFF_MAX) : RAILTEST_BACKOFF_MIN;
+    _railtestBackoffTimer.start(_railtestBackoff);
+
+    _logger->logDebug(QString("SLIP. DUT debug transmit buffer full on %1, railtest paused for %2 ms.").arg(_portName).arg(_railtestBackoff));
+}
+
+void PortManager::onRailtestBackoffTimeout()
+{
+    while (!_deferredRailtestFrames.isEmpty())
+    {
+        auto frame = _deferredRailtestFrames.dequeue();
+
+        // The command's timeout counts from when it actually goes out.
+        _rail[frame.first].timer.start();
+        sendFrame(frame.first, frame.second);
+    }
+}
+
+void PortManager::sendRailtestFrame(int channel, const QByteArray &frame)
+{
+    if (_railtestBackoffTimer.isActive())
+        _deferredRailtestFrames.enqueue(qMakePair(channel, frame));
+    else
+        sendFrame(channel, frame);
+}
+
+// An expired command counts as a sample at its timeout, weighted to lift the 99th percentile
+// to it at once; the next timeout of the command is then twice as long.
+static void addLatency(LatencyHistogram &histogram, qint64 usecs, bool expired)
+{
+    histogram.add(usecs, expired ? quint32(histogram.count() / 50 + 1) : 1);
+
+    if (histogram.count() >= ADAPTIVE_TIMEOUT_WINDOW)
+        histogram.age();
+}
+
+void PortManager::addRailtestLatency(const QByteArray &command, qint64 usecs, bool expired)
+{
+    if (!_railtestLatency.contains(command) && _railtestLatency.size() >= RAILTEST_LATENCY_MAX_COMMANDS)
+    {
+        auto it = _railtestLatency.begin();
+
+        while (it != _railtestLatency.end())
+        {
+            if (it.value().count() < ADAPTIVE_TIMEOUT_MIN_SAMPLES)
+                it = _railtestLatency.erase(it);
+            else
+                ++it;
         }
-        else
-            decodedBuffer.append(ch);
     }
-    if (decodedBuffer.size() < MIN_FRAME_SIZE)
+
+    addLatency(_railtestLatency[command], usecs, expired);
+}
+
+int PortManager::timeoutFor(const LatencyHistogram *histogram) const
+{
+    if (!_adaptiveTimeouts || !histogram || histogram->count() < ADAPTIVE_TIMEOUT_MIN_SAMPLES)
+        return _timeout;
+
+    qint64 p99 = (histogram->percentile(0.99) + 999) / 1000;
+
+    return int(qMin<qint64>(_timeout, qMax<qint64>(2 * p99, p99 + ADAPTIVE_TIMEOUT_MIN_MARGIN)));
+}
+
+QVariantMap PortManager::latencyStatistics() const
+{
+    QVariantMap slip;
+    QVariantMap railtest;
+
+    for (auto it = _slipLatency.begin(); it != _slipLatency.end(); ++it)
+    {
+        auto name = mbCommandName(it.key());
+        auto statistics = it.value().toVariantMap();
+
+        statistics.insert("timeout", timeoutFor(&it.value()));
+        slip.insert(name ? QString(name) : QString("0x%1").arg(it.key(), 4, 16, QChar('0')), statistics);
+    }
+
+    for (auto it = _railtestLatency.begin(); it != _railtestLatency.end(); ++it)
     {
-        _logger->logError("SLIP. Decode frame. Frame too short.");
-        return;
+        auto statistics = it.value().toVariantMap();
+
+        statistics.insert("timeout", timeoutFor(&it.value()));
+        railtest.insert(it.key().isEmpty() ? QString("(prompt)") : QString(it.key()), statistics);
     }
 
-    // Calculate CRC.
-    int frameSize = decodedBuffer.size() - 2;
-    quint16
-        frameCrc = 0xFFFF,
-        bufferCrc = (quint8)decodedBuffer.at(frameSize + 1) | ((quint16)decodedBuffer.at(frameSize) << 8);
+    QVariantMap result;
+
+    result.insert("slip", slip);
+    result.insert("railtest", railtest);
+
+    return result;
+}
+
+void PortManager::resetLatencyStatistics()
+{
+    _slipLatency.clear();
+    _railtestLatency.clear();
+}
+
+void PortManager::onCommandTimerTimeout()
+{
+    QList<quint8> expired;
+
+    for (auto & command : _commandsInFlight)
+    {
+        if (command.timer.elapsed() >= command.timeout)
+            expired.push_back(command.sequence);
+    }
 
-    for (int i = 0; i < frameSize; ++i)
+    for (auto sequence : expired)
     {
-        quint8 index = (quint8)decodedBuffer.at(i) ^ (frameCrc >> 8);
+        auto &command = _commandsInFlight[sequence];
+
+        addLatency(_slipLatency[command.type], command.timer.nsecsElapsed() / 1000, true);
+        finishSlipCommand(sequence, QStringList());
+    }
+
+    restartCommandTimer();
+}
+
+QStringList PortManager::railtestCommand(int channel, const QByteArray &cmd)
+{
+    if(channel < 1 || channel > 3)
+        return QStringList();
+
+    postRailtestCommand(channel, cmd);
+    waitRailtestReplies(QList<int>() << channel);
+
+    auto &reply = _rail[channel].reply;
+    auto response = RailtestReply::tokenize(reply.constData(), reply.size());
+
+    emit responseRecieved(response);
+    return response;
+}
 
-        frameCrc = _crc_ccitt_lut[index] ^ (frameCrc << 8);
+QMap<int, QStringList> PortManager::railtestCommands(const QMap<int, QByteArray> &commands)
+{
+    return railtestResponses(postRailtestCommands(commands));
+}
+
+QMap<int, QVector<RailtestReply>> PortManager::railtestReplies(const QMap<int, QByteArray> &commands)
+{
+    return railtestRecords(postRailtestCommands(commands));
+}
+
+QList<int> PortManager::postRailtestCommands(const QMap<int, QByteArray> &commands)
+{
+    QList<int> channels;
+
+    for (auto it = commands.begin(); it != commands.end(); ++it)
+    {
+        if (it.key() >= 1 && it.key() <= 3)
+        {
+            postRailtestCommand(it.key(), it.value());
+            channels.append(it.key());
+        }
     }
 
-    // Check CRC.
-    if (frameCrc != bufferCrc)
+    return channels;
+}
+
+QMap<int, QStringList> PortManager::railtestResponses(const QList<int> &channels)
+{
+    QMap<int, QStringList> responses;
+
+    waitRailtestReplies(channels);
+
+    for (auto channel : channels)
     {
-        _logger->logError("SLIP. Decode frame. Invalid Frame CRC.");
-        return;
+        auto &reply = _rail[channel].reply;
+
+        responses.insert(channel, RailtestReply::tokenize(reply.constData(), reply.size()));
     }
 
-    // Frame received successfully.
+    return responses;
+}
+
+QMap<int, QVector<RailtestReply>> PortManager::railtestRecords(const QList<int> &channels)
+{
+    QMap<int, QVector<RailtestReply>> replies;
+
+    waitRailtestReplies(channels);
+
+    for (auto channel : channels)
+        replies.insert(channel, RailtestReply::parseAll(_rail[channel].reply));
+
+    return replies;
+}
+
+bool PortManager::isRailtestPending(int channel) const
+{
+    if (channel < 1 || channel > 3 || !_rail[channel].busy)
+        return false;
+
+    bool deferred = std::any_of(_deferredRailtestFrames.begin(), _deferredRailtestFrames.end(),
+                                [channel](const QPair<int, QByteArray> &frame) {return frame.first == channel;});
+
+    return deferred || _rail[channel].timer.elapsed() < _rail[channel].timeout;
+}
 
-    int channel = decodedBuffer.at(0);
-    QByteArray frame = decodedBuffer.mid(1, frameSize - 1);
+void PortManager::postRailtestCommand(int channel, const QByteArray &cmd)
+{
+    auto &rail = _rail[channel];
+
+    rail.busy = true;
+    rail.reply.clear();
+    rail.output.clear();
+    // Keyed by the whole line, the arguments can change how long a command takes.
+    rail.command = cmd.trimmed();
+
+    auto histogram = _railtestLatency.find(rail.command);
+
+    rail.timeout = timeoutFor(histogram == _railtestLatency.end() ? nullptr : &histogram.value());
+    rail.timer.start();
+    sendRailtestFrame(channel, cmd + "\r\n\r\n");
+}
+
+void PortManager::waitRailtestReplies(const QList<int> &channels)
+{
+    auto isBusy = [this, &channels]()
+    {
+        for (auto channel : channels)
+        {
+            if (channel >= 1 && channel <= 3 && _rail[channel].busy)
+                return true;
+        }
+        return false;
+    };
 
-    switch(_mode)
+    // Each channel has its own deadline; wait for the nearest one, then expire what is due.
+    while (isBusy())
     {
-    case slipMode:
-        onSlipPacketReceived(decodedBuffer.at(0), frame);
-        break;
+        qint64 remaining = std::numeric_limits<qint64>::max();
 
-    case railMode:
-        if(channel < 4)
+        for (auto channel : channels)
         {
-            _railReply[channel] += frame;
-            if(frame.contains("> "))
+            if (channel < 1 || channel > 3 || !_rail[channel].busy)
+                continue;
+
+            auto &rail = _rail[channel];
+
+            // A command held back by the railtest backoff has not gone out yet.
+            bool deferred = std::any_of(_deferredRailtestFrames.begin(), _deferredRailtestFrames.end(),
+                                        [channel](const QPair<int, QByteArray> &frame) {return frame.first == channel;});
+
+            if (deferred)
+            {
+                remaining = qMin<qint64>(remaining, qMax(1, _railtestBackoffTimer.remainingTime()));
+                continue;
+            }
+
+            qint64 left = rail.timeout - rail.timer.elapsed();
+
+            if (left <= 0)
             {
-                onSlipPacketReceived(channel, _railReply[channel]);
-                _railReply[channel].clear();
+                addRailtestLatency(rail.command, rail.timer.nsecsElapsed() / 1000, true);
+                rail.busy = false;
+                rail.reply.clear();
+                _logger->logDebug(QString("Timeout for the response waiting on channel %1.").arg(channel));
+                continue;
             }
+
+            remaining = qMin(remaining, left);
+        }
+
+        if (isBusy())
+            _waiter.wait([&isBusy]() {return !isBusy();}, int(remaining));
+    }
+}
+
+void PortManager::onFramesReceived()
+{
+    _worker->takeFrames([this](const SlipFrame &frame)
+    {
+        onFrameDecoded(frame.channel, frame.payload.constData(), frame.payload.size());
+    });
+}
+
+void PortManager::onWorkerErrorOccurred(QString message)
+{
+    _logger->logError(message);
+}
+
+void PortManager::onFrameDecoded(quint8 channel, const char *payload, int size) Q_DECL_NOTHROW
+{
+    // Board replies are dispatched regardless of a pending railtest command, so both can be in flight.
+    if (channel == 0)
+    {
+        onSlipPacketReceived(channel, payload, size);
+    }
+
+    else if (channel < 4 && _rail[channel].busy)
+    {
+        auto &reply = _rail[channel].reply;
+
+        if (reply.size() + size > MAX_RAIL_REPLY_SIZE)
+        {
+            _logger->logError(QString("Railtest reply on channel %1 is too long, dropped.").arg(channel));
+            reply.clear();
         }
-        break;
+
+        reply.append(payload, size);
+        if(QByteArray::fromRawData(payload, size).contains("> "))
+            onSlipPacketReceived(channel, reply.constData(), reply.size());
+    }
+
+    else if (channel < 4)
+    {
+        onRailtestOutput(channel, payload, size);
     }
 }
 
-void PortManager::onSlipPacketReceived(quint8 channel, QByteArray frame) noexcept
+void PortManager::onRailtestOutput(quint8 channel, const char *data, int size) Q_DECL_NOTHROW
+{
+    auto &output = _rail[channel].output;
+
+    if (output.size() + size > MAX_RAIL_REPLY_SIZE)
+        output.clear();
+
+    output.append(data, size);
+
+    int start = 0;
+    int end = output.indexOf("\r\n");
+
+    // A record may follow the "> " left over from the last prompt.
+    for (; end != -1; start = end + 2, end = output.indexOf("\r\n", start))
+    {
+        int record = output.indexOf("{{", start);
+
+        if (record != -1 && record < end)
+            emit railtestOutput(channel, output.mid(record, end - record));
+    }
+
+    output.remove(0, start);
+}
+
+void PortManager::onSlipPacketReceived(quint8 channel, const char *data, int size) Q_DECL_NOTHROW
 {
     switch (channel)
     {
         case 0:
-            if (frame.size() >= (int)sizeof(MB_Packet_t))
+            if (size >= (int)sizeof(MB_Packet_t))
             {
-                MB_Packet_t *pkt = (MB_Packet_t*)frame.data();
+                auto pkt = reinterpret_cast<const MB_Packet_t*>(data);
 
-                pkt->type = qFromBigEndian(pkt->type);
-                switch (pkt->type)
+                switch (qFromBigEndian(pkt->type))
                 {
                     case MB_STARTUP:
                         _logger->logInfo("Startup event.");
+                        emit boardStarted();
                         break;
 
                     case MB_GENERAL_RESULT:
+                        if (size >= (int)sizeof(MB_GeneralResult_t))
                         {
-                            MB_GeneralResult_t *gr = (MB_GeneralResult_t*)pkt;
+                            auto gr = reinterpret_cast<const MB_GeneralResult_t*>(data);
 
-                            gr->errorCode = qFromBigEndian(gr->errorCode);
-                            _response.push_back(QString().setNum(gr->errorCode));
+                            finishSlipCommand(gr->header.sequence, QStringList(QString().setNum(qFromBigEndian(gr->errorCode))));
                         }
                         break;
 
+                    case MB_BATCH_RESULT:
+                    {
+                        QStringList results;
+                        int count = qMin<int>(pkt->dataLen, size - (int)sizeof(MB_Packet_t)) / (int)sizeof(qint32);
+                        auto result = data + sizeof(MB_Packet_t);
+
+                        for (int i = 0; i < count; ++i, result += sizeof(qint32))
+                            results.append(QString().setNum(qFromBigEndian<qint32>(result)));
+
+                        finishSlipCommand(pkt->sequence, results);
+                        break;
+                    }
+
                     case MB_ASYNC_EVENT:
+                        if (size >= (int)sizeof(MB_Event_t))
                         {
-                            MB_Event_t *evt = (MB_Event_t*)pkt;
-
-                            evt->eventCode = qFromBigEndian(evt->eventCode);
-                            _logger->logInfo(QString("EVENT: code=%2.").arg(evt->eventCode));
+                            auto evt = reinterpret_cast<const MB_Event_t*>(data);
+                            int code = qFromBigEndian(evt->eventCode);
+
+                            // Flow control events are handled here, the others only reported.
+                            if (code == MB_EVENT_CMDQUEUE_FULL)
+                                onCommandQueueFull();
+                            else if (code == MB_EVENT_DUTDBGTX_FULL)
+                                onDutDebugTxFull();
+                            else
+                                _logger->logInfo(QString("EVENT: code=%1.").arg(code));
+
+                            emit asyncEvent(code);
                         }
                         break;
                 }
@@ -323,104 +818,55 @@ void PortManager::onSlipPacketReceived(quint8 channel, QByteArray frame) noexcep
         case 1:
         case 2:
         case 3:
-            _response = QString(frame).replace(QChar('{'), QChar(' ')).replace(QChar('}'), QChar(' ')).replace(QChar('\n'), QChar(' ')).replace(QChar('\r'), QChar(' ')).replace(QChar('>'), QChar(' ')).simplified().split(' ');
-//            processFrameFromRail(frame);
+            // The complete reply stays in _rail[channel].reply until the next command.
+            Q_UNUSED(data);
+            Q_UNUSED(size);
+            addRailtestLatency(_rail[channel].command, _rail[channel].timer.nsecsElapsed() / 1000, false);
+
+            // A complete reply means the DUT debug buffer drained, the next overflow starts a fresh backoff.
+            if (!_railtestBackoffTimer.isActive())
+                _railtestBackoff = 0;
+
+            _rail[channel].busy = false;
+            _waiter.wake();
+            emit railtestReplied(channel);
             break;
     }
-
-    _mode = idleMode;
-}
-
-void PortManager::decodeRailtestReply(const QByteArray &reply)
-{
-    if (reply.startsWith("{{(") && reply.endsWith("}}"))
-    {
-        int idx = reply.indexOf(")}");
-
-        if (idx == -1)
-            return;
-
-        auto name = reply.mid(3, idx - 3);
-        auto params = reply.mid(idx + 2, reply.length() - idx - 3).split('}');
-        QVariantMap decodedParams;
-
-        foreach (auto param, params)
-            if (param.startsWith('{'))
-            {
-                idx = param.indexOf(':');
-                if (idx != -1)
-                    decodedParams.insert(param.mid(1, idx - 1), param.mid(idx + 1));
-            }
-
-        if (_syncCommand == name)
-            _syncReplies.append(decodedParams);
-
-        return;
-    }
-
-    if (reply.startsWith("{{") && reply.endsWith("}}"))
-    {
-        auto params = reply.mid(1, reply.length() - 2).split('}');
-        QVariantList decodedParams;
-
-        foreach (auto param, params)
-            if (param.startsWith('{'))
-                decodedParams.append(param.mid(1));
-
-        if (!_syncCommand.isEmpty())
-            _syncReplies.push_back(decodedParams);
-
-        return;
-    }
 }
 
 void PortManager::sendFrame(int channel, const QByteArray &frame) Q_DECL_NOTHROW
 {
     QByteArray encodedBuffer;
-    quint16 frameCrc = 0xFFFF;
+    quint8 channelOctet = channel;
+    quint16 frameCrc = crcCcitt(crcCcitt(CRC_CCITT_INIT, &channelOctet, 1), frame.constData(), frame.size());
 
     // Write UART wake up symbols and SLIP frame start.
     encodedBuffer.reserve((frame.size() + 3) * 2 + 2);
-    encodedBuffer.append(END_SLIP_OCTET);
+    encodedBuffer.append(SlipDecoder::END_OCTET);
 
     // Write escaped channel number.
-    quint8 index = channel ^ (frameCrc >> 8);
-
-    _encodeSymbol(encodedBuffer, channel);
-    frameCrc = _crc_ccitt_lut[index] ^ (frameCrc << 8);
-
-    // Write escaped frame and calculate CRC.
-    foreach (char ch, frame)
-    {
-        quint8 index = (quint8)ch ^ (frameCrc >> 8);
+    _encodeSymbol(encodedBuffer, channelOctet);
 
+    // Write escaped frame.
+    for (char ch : frame)
         _encodeSymbol(encodedBuffer, ch);
-        frameCrc = _crc_ccitt_lut[index] ^ (frameCrc << 8);
-    }
 
     // Write escaped CRC.
     _encodeSymbol(encodedBuffer, frameCrc >> 8);
     _encodeSymbol(encodedBuffer, frameCrc & 0xFF);
 
     // Write SLIP frame end.
-    encodedBuffer.append(END_SLIP_OCTET);
+    encodedBuffer.append(SlipDecoder::END_OCTET);
 
-    // Write encoded frame to serial port.
+    // Hand the encoded frame over to the I/O thread.
 //    qDebug() << "Frame to be sended: " << frame << " ; encoded: " << encodedBuffer;
-    _serial.write(encodedBuffer);
-    waitCommandFinished();
+    if (!_worker->send(encodedBuffer))
+        _logger->logError("Transmit queue overflow on port " + _portName + ", frame dropped.");
 }
 
-void PortManager::waitCommandFinished()
+void PortManager::sendEncodedFrame(const MbEncodedFrame &frame) Q_DECL_NOTHROW
 {
-    QTime expire = QTime::currentTime().addMSecs(_timeout);
-    while(_mode != idleMode)
-    {
-        QCoreApplication::processEvents();
-
-        if(QTime::currentTime() > expire)
-        {
-            _mode = idleMode;
-        }
-    }
+    // The frame lives in a static table, so the I/O thread can use it without a copy.
+    if (!_worker->send(QByteArray::fromRawData(frame.data, frame.size)))
+        _logger->logError("Transmit queue overflow on port " + _portName + ", frame dropped.");
 }
@@ -1,10 +1,22 @@
 #ifndef PORTMANAGER_H
 #define PORTMANAGER_H
 
+#include <functional>
+
 #include <QSerialPort>
 #include <QSharedPointer>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QQueue>
+#include <QMap>
 
 #include "SlipProtocol.h"
+#include "MbCodec.h"
+#include "RailtestReply.h"
+#include "SerialWorker.h"
+#include "Waiter.h"
+#include "LatencyHistogram.h"
 #include "Logger.h"
 
 class PortManager : public QObject
@@ -13,9 +25,11 @@ class PortManager : public QObject
 
 public:
 
-    enum Mode {idleMode, railMode, slipMode};
+    // Called once per posted SLIP command, either with the board reply or with an empty list on timeout.
+    using CommandCallback = std::function<void(quint8 sequence, const QStringList &response)>;
 
     explicit PortManager(QObject *parent = nullptr);
+    ~PortManager();
 
     void setPort(const QString &name,
                  qint32 baudRate = QSerialPort::Baud115200,
@@ -26,6 +40,52 @@ public:
 
     void setLogger(const QSharedPointer<Logger>& logger) {_logger = logger;}
 
+    // Asynchronous SLIP command API. The packet sequence number is assigned here and
+    // the MB_GENERAL_RESULT reply is matched back to the request by that number.
+    quint8 postSlipCommand(int channel, const QByteArray &frame, CommandCallback callback = CommandCallback());
+    quint8 postSlipCommand(const MbEncodedFrames &frames, CommandCallback callback = CommandCallback());
+    QStringList waitSlipCommand(quint8 sequence);
+    bool isSlipCommandPending(quint8 sequence) const;
+    int pendingSlipCommands() const {return _queuedCommands.size() + _commandsInFlight.size();}
+
+    // Board command sent as one of its pre-encoded frames, see MbCodec.h.
+    QStringList slipCommand(const MbEncodedFrames &frames);
+
+    // Sends MB_COMMAND_TABLE packets in as few MB_BATCH frames as fit and returns one result
+    // per packet, empty where the board did not answer. Falls back to one frame per packet
+    // once the board turns out not to support MB_BATCH.
+    QStringList slipBatch(const QList<QByteArray> &packets);
+    bool batchSupported() const {return _batchSupported;}
+
+    // Same as railtestCommands(), with each channel's reply parsed into records.
+    QMap<int, QVector<RailtestReply>> railtestReplies(const QMap<int, QByteArray> &commands);
+
+    // railtestCommands() and railtestReplies() in two halves: post returns the channels the
+    // commands went to, the others wait for what is still pending and collect the replies.
+    // In between railtestReplied() reports each reply as it completes.
+    QList<int> postRailtestCommands(const QMap<int, QByteArray> &commands);
+    QMap<int, QStringList> railtestResponses(const QList<int> &channels);
+    QMap<int, QVector<RailtestReply>> railtestRecords(const QList<int> &channels);
+
+    // The command is neither answered nor timed out yet.
+    bool isRailtestPending(int channel) const;
+
+    // Size of the last complete railtest reply on the channel, prompt included.
+    int railtestReplySize(int channel) const {return channel >= 1 && channel <= 3 ? _rail[channel].reply.size() : 0;}
+
+    // Once a command type has enough samples its timeout is derived from its observed
+    // latency instead of the configured one, which remains the upper limit. A timeout
+    // lengthens the next one; old samples age out, so the timeout follows the latency.
+    void setAdaptiveTimeouts(bool enabled) {_adaptiveTimeouts = enabled;}
+    bool adaptiveTimeouts() const {return _adaptiveTimeouts;}
+
+    void setMaxCommandsInFlight(int value) {_maxCommandsInFlight = qMax(1, value); _commandWindow = _maxCommandsInFlight;}
+    int maxCommandsInFlight() const {return _maxCommandsInFlight;}
+
+    // Commands currently allowed in flight. MB_EVENT_CMDQUEUE_FULL halves it, every
+    // window's worth of answered commands grows it by one up to maxCommandsInFlight().
+    int commandWindow() const {return _commandWindow;}
+
 public slots:
 
     void open();
@@ -34,39 +94,117 @@ public slots:
     QStringList slipCommand(int channel, const QByteArray &frame);
     QStringList railtestCommand(int channel, const QByteArray &cmd);
 
+    // Issues railtest commands to several DUT channels at once and collects each channel's
+    // reply independently, every channel with its own prompt detection and timeout.
+    QMap<int, QStringList> railtestCommands(const QMap<int, QByteArray> &commands);
+
     void setTimeout(int value) {_timeout = value;}
 
+    // Latency histograms per MB_* command and per railtest command line, with the timeout in use.
+    QVariantMap latencyStatistics() const;
+    void resetLatencyStatistics();
+
 signals:
 
     void responseRecieved(QStringList response);
+    void slipCommandFinished(quint8 sequence, QStringList response);
+
+    // Every MB_ASYNC_EVENT, MB_EVENT_* code. Events never complete or fail a command.
+    void asyncEvent(int code);
+
+    // MB_STARTUP: the board has (re)started, its DUTs are off and its switches in the default state.
+    void boardStarted();
+
+    // The reply of a posted railtest command is complete.
+    void railtestReplied(int channel);
+
+    // A railtest record line the DUT printed with no command pending, e.g. {{(txEnd)}...}.
+    void railtestOutput(int channel, QByteArray line);
 
 private slots:
 
-    void onSerialPortReadyRead();
-    void onSerialPortErrorOccurred(QSerialPort::SerialPortError errorCode);
+    void onFramesReceived();
+    void onWorkerErrorOccurred(QString message);
     void sendFrame(int channel, const QByteArray &frame) Q_DECL_NOTHROW;
-    void processResponsePacket();
-    void decodeFrame() Q_DECL_NOTHROW;
-    void onSlipPacketReceived(quint8 channel, QByteArray frame) Q_DECL_NOTHROW;
-    void decodeRailtestReply(const QByteArray &reply);
-    void waitCommandFinished();
+    void onFrameDecoded(quint8 channel, const char *payload, int size) Q_DECL_NOTHROW;
+    void onSlipPacketReceived(quint8 channel, const char *data, int size) Q_DECL_NOTHROW;
+    void onRailtestOutput(quint8 channel, const char *data, int size) Q_DECL_NOTHROW;
+    void onCommandTimerTimeout();
+    void onRailtestBackoffTimeout();
 
 private:
 
+    struct RailChannel
+    {
+        bool busy = false;
+        QByteArray reply;
+        QByteArray command;
+        QByteArray output;
+        int timeout = 0;
+        QElapsedTimer timer;
+    };
+
+    struct SlipCommand
+    {
+        quint8 sequence;
+        quint16 type;
+        int channel;
+        QByteArray frame;
+        const MbEncodedFrames *encodedFrames;
+        CommandCallback callback;
+        int timeout;
+        QElapsedTimer timer;
+    };
+
+    quint8 nextSequence();
+    quint8 postSlipCommand(SlipCommand &command);
+    void sendEncodedFrame(const MbEncodedFrame &frame) Q_DECL_NOTHROW;
+    int timeoutFor(const LatencyHistogram *histogram) const;
+    void addRailtestLatency(const QByteArray &command, qint64 usecs, bool expired);
+    void sendQueuedCommands();
+    void finishSlipCommand(quint8 sequence, const QStringList &response);
+    void restartCommandTimer();
+    void onCommandQueueFull();
+    void onDutDebugTxFull();
+    void sendRailtestFrame(int channel, const QByteArray &frame);
+    void postRailtestCommand(int channel, const QByteArray &cmd);
+    void waitRailtestReplies(const QList<int> &channels);
+
     QSharedPointer<Logger> _logger;
-    QSerialPort _serial;
-    Mode _mode = idleMode;
 
-    bool _frameStarted;
-    QByteArray _recvBuffer;
+    // The serial port itself is driven by _worker in _ioThread.
+    QThread _ioThread;
+    SerialWorker *_worker;
 
-    QByteArray _syncCommand;
-    QVariantList _syncReplies;
+    QString _portName;
+    qint32 _baudRate = QSerialPort::Baud115200;
+    QSerialPort::DataBits _dataBits = QSerialPort::Data8;
+    QSerialPort::Parity _parity = QSerialPort::NoParity;
+    QSerialPort::StopBits _stopBits = QSerialPort::OneStop;
+    QSerialPort::FlowControl _flowControl = QSerialPort::NoFlowControl;
 
-    QStringList _response;
     int _timeout = 10000;
-
-    QByteArray _railReply[4];
+    bool _adaptiveTimeouts = true;
+    QHash<quint16, LatencyHistogram> _slipLatency;
+    QHash<QByteArray, LatencyHistogram> _railtestLatency;
+
+    RailChannel _rail[4];
+
+    quint8 _sequence = 0;
+    int _maxCommandsInFlight = 4;
+    int _commandWindow = 4;
+    int _commandWindowCredit = 0;
+    bool _batchSupported = true;
+    QQueue<SlipCommand> _queuedCommands;
+    QMap<quint8, SlipCommand> _commandsInFlight;
+    QMap<quint8, QStringList> _unclaimedResponses;
+    QTimer _commandTimer;
+    Waiter _waiter;
+
+    // Railtest frames wait here while the board's DUT debug transmit buffer drains.
+    QTimer _railtestBackoffTimer;
+    int _railtestBackoff = 0;
+    QQueue<QPair<int, QByteArray>> _deferredRailtestFrames;
 };
 
 #endif // PORTMANAGER_H
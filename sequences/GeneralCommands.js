@@ -1,14 +1,77 @@
 const SLOTS_NUMBER = 3;
+
+// Parallel radio test: DUTs of one group share the channel in slots of RADIO_SLOT_TIME ms,
+// the reference module cannot report packets faster. Each DUT writes its number into the
+// payload octet at RADIO_MARKER_OFFSET, past the BLE PDU header.
+const RADIO_SLOT_TIME = 10;
+const RADIO_TX_DELAY = 25;
+const RADIO_MARKER_OFFSET = 2;
+const RADIO_TAIL_TIME = 500;
 var jlinkList = [];
 var testClientList = [];
 
+// Sleeps without blocking the event loop, the boards keep reporting meanwhile.
 function delay(milliseconds)
 {
-  const date = Date.now();
-  let currentDate = null;
-  do {
-    currentDate = Date.now();
-  } while (currentDate - date < milliseconds);
+    scheduler.sleep(milliseconds);
+}
+
+// A board's task re-checks its railtest commands this often in case a reply notification is missed.
+const RAILTEST_POLL_INTERVAL = 100;
+
+// One board's share of railtestForCheckedDuts: the commands go out on all its slots, then
+// the task gives way to the other boards until the replies are in or have timed out.
+function* railtestBoard(testClient, slots, command, parsed)
+{
+    testClient.postRailtestCommands(slots, command);
+
+    while(testClient.isRailtestPending())
+        yield scheduler.signal(testClient, "railtestReplied(int)", RAILTEST_POLL_INTERVAL);
+
+    return testClient.takeRailtestResponses(parsed);
+}
+
+// Runs the railtest command on all checked DUTs, all boards and their slots concurrently.
+// Returns a list of {testClient, slot, response} in slot order; with parsed set the
+// response is the list of reply records {name, params, values} instead of words.
+function railtestForCheckedDuts(command, parsed)
+{
+    let boards = [];
+    let tasks = [];
+
+    for (let i = 0; i < testClientList.length; i++)
+    {
+        let testClient = testClientList[i];
+        let slots = [];
+
+        for (let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        {
+            if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
+                slots.push(slot);
+        }
+
+        if(slots.length === 0)
+            continue;
+
+        boards.push({testClient: testClient, slots: slots});
+        tasks.push(scheduler.spawn(railtestBoard, [testClient, slots, command, !!parsed]));
+    }
+
+    let responses = scheduler.join(tasks);
+    let results = [];
+
+    for (let i = 0; i < boards.length; i++)
+    {
+        for (let j = 0; j < boards[i].slots.length; j++)
+        {
+            let slot = boards[i].slots[j];
+            results.push({testClient: boards[i].testClient, slot: slot, response: (responses[i] || {})[slot] || []});
+        }
+    }
+
+    results.sort(function(a, b) {return a.slot - b.slot;});
+
+    return results;
 }
 
 GeneralCommands =
@@ -35,8 +98,7 @@ GeneralCommands =
                 let jlink = jlinkList[i];
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
                 {
-                    testClient.powerOn(slot);
-                    delay(1000);
+                    testClient.ensurePowered(slot);
                     testClient.switchSWD(slot);
 
                     jlink.selectByUSB();
@@ -56,37 +118,54 @@ GeneralCommands =
 
     unlockAndEraseChip: function ()
     {
+        // The J-Link library has one global session, so each open...close block runs uninterrupted.
+        function eraseChip(testClient, jlink, slot)
+        {
+            testClient.ensurePowered(slot);
+            testClient.switchSWD(slot);
+
+            jlink.selectByUSB();
+            jlink.open();
+            jlink.setDevice("EFR32FG12PXXXF1024");
+            jlink.select();
+            jlink.setSpeed(5000);
+            jlink.connect();
+            let result = jlink.erase();
+            jlink.close();
+
+            return result;
+        }
+
+        // Only the power cycle of a DUT that failed to erase waits as a task, the DUTs are cycled at once.
+        function* powerCycle(testClient, slot)
+        {
+            testClient.powerOff(slot);
+            yield scheduler.after(5000);
+            testClient.powerOn(slot);
+        }
+
+        let failed = [];
+
         for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
         {
             for (var i = 0; i < testClientList.length; i++)
             {
                 let testClient = testClientList[i];
-                let jlink = jlinkList[i];
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
                 {
-                    testClient.powerOn(slot);
-                    testClient.switchSWD(slot);
-                    delay(1000);
-
-                    jlink.selectByUSB();
-                    jlink.open();
-                    jlink.setDevice("EFR32FG12PXXXF1024");
-                    jlink.select();
-                    jlink.setSpeed(5000);
-                    jlink.connect();
-                    if (jlink.erase() < 0)
-                    {
-                        testClient.powerOff(slot);
-                        delay(5000);
-                        testClient.powerOn(slot);
-                        jlink.connect();
-                        jlink.erase();
-                    }
-
-                    jlink.close();
+                    if (eraseChip(testClient, jlinkList[i], slot) < 0)
+                        failed.push({index: i, slot: slot});
                 }
             }
         }
+
+        if (failed.length === 0)
+            return;
+
+        scheduler.join(failed.map(function(dut) {return scheduler.spawn(powerCycle, [testClientList[dut.index], dut.slot]);}));
+
+        for (var j = 0; j < failed.length; j++)
+            eraseChip(testClientList[failed[j].index], jlinkList[failed[j].index], failed[j].slot);
     },
 
     //---
@@ -103,8 +182,7 @@ GeneralCommands =
                 let jlink = jlinkList[i];
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
                 {
-                    testClient.powerOn(slot);
-                    delay(1000);
+                    testClient.ensurePowered(slot);
                     testClient.switchSWD(slot);
 
                     jlink.selectByUSB();
@@ -187,8 +265,7 @@ GeneralCommands =
                 let jlink = jlinkList[i];
                 if(testClient.isDutChecked(slot) && (testClient.dutState(slot) === 2))
                 {
-                    testClient.powerOn(slot);
-                    delay(1000);
+                    testClient.ensurePowered(slot);
                     testClient.switchSWD(slot);
 
                     jlink.selectByUSB();
@@ -308,21 +385,35 @@ GeneralCommands =
 
     powerOn: function ()
     {
-        for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        // One batch per board switches all of its DUTs.
+        for (var i = 0; i < testClientList.length; i++)
         {
-            for (var i = 0; i < testClientList.length; i++)
-            {
-                let testClient = testClientList[i];
-                if(!testClient.isConnected())
-                    continue;
+            let testClient = testClientList[i];
+            if(!testClient.isConnected())
+                continue;
 
+            let batch = testClient.batch();
+            let slots = [];
+
+            for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+            {
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
                 {
-                    testClient.powerOn(slot);
-                    logger.logInfo("DUT " + testClient.dutNo(slot) + " is switched ON");
-                    logger.logDebug("DUT " + testClient.dutNo(slot) + " is switched ON");
+                    batch.powerOn(slot);
+                    slots.push(slot);
                 }
             }
+
+            if(slots.length === 0)
+                continue;
+
+            batch.submit();
+
+            for (var j = 0; j < slots.length; j++)
+            {
+                logger.logInfo("DUT " + testClient.dutNo(slots[j]) + " is switched ON");
+                logger.logDebug("DUT " + testClient.dutNo(slots[j]) + " is switched ON");
+            }
         }
     },
 
@@ -366,6 +457,61 @@ GeneralCommands =
 
     //---
 
+    raiseRailtestBaud: function ()
+    {
+        for (var i = 0; i < testClientList.length; i++)
+        {
+            let testClient = testClientList[i];
+            if(!testClient.isConnected())
+                continue;
+
+            for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+            {
+                if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
+                    logger.logDebug("DUT " + testClient.dutNo(slot) + " railtest link: " + testClient.negotiateRailtestBaud(slot) + " baud");
+            }
+        }
+    },
+
+    //---
+
+    benchmarkRailtest: function ()
+    {
+        for (var i = 0; i < testClientList.length; i++)
+        {
+            let testClient = testClientList[i];
+            if(!testClient.isConnected())
+                continue;
+
+            for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+            {
+                if(!testClient.isDutAvailable(slot) || !testClient.isDutChecked(slot))
+                    continue;
+
+                let result = testClient.benchmarkRailtest(slot, "getmemw 0x0FE081F0 2", 50);
+
+                logger.logInfo("DUT " + testClient.dutNo(slot) + " railtest at " + result.baud + " baud: " +
+                               result.replies + "/" + result.commands + " replies, " +
+                               result.commandsPerSecond.toFixed(1) + " commands/s, " +
+                               Math.round(result.bytesPerSecond) + " bytes/s");
+            }
+        }
+    },
+
+    //---
+
+    logLatencyStatistics: function ()
+    {
+        for (var i = 0; i < testClientList.length; i++)
+        {
+            let testClient = testClientList[i];
+            if(testClient.isConnected())
+                testClient.logLatencyStatistics();
+        }
+    },
+
+    //---
+
     clearDutsInfo: function ()
     {
         for (var i = 0; i < testClientList.length; i++)
@@ -384,19 +530,19 @@ GeneralCommands =
     {
         actionHintWidget.showProgressHint("Detecting DUTs in the testing fixture...");
 
-        for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        for (var i = 0; i < testClientList.length; i++)
         {
-            for (var i = 0; i < testClientList.length; i++)
-            {
-                let testClient = testClientList[i];
+            let testClient = testClientList[i];
 
-                if(!testClient.isConnected())
-                    continue;
+            if(!testClient.isConnected())
+                continue;
 
-                testClient.setTimeout(500);
-                testClient.powerOff(slot);
-                testClient.setTimeout(10000);
-            }
+            testClient.setTimeout(500);
+            let batch = testClient.batch();
+            for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+                batch.powerOff(slot);
+            batch.submit();
+            testClient.setTimeout(10000);
         }
         delay(100);
 
@@ -415,13 +561,18 @@ GeneralCommands =
                     testClient.setTimeout(500);
 //                    logger.logDebug("Attempting connection to slot " + slot + " of board " + testClient.no() + "...");
 
-                    var prevCSA = testClient.readCSA(0);
+                    // Current before and after switching the slot on, each read twice in one round trip
+                    // as a spurious 0 is retried. The power-on stays a round trip of its own, so the
+                    // current has risen by the time it is measured.
+                    var results = testClient.batch().readCSA(0).readCSA(0).submit();
+                    var prevCSA = results[0];
                     if (prevCSA === 0)
-                        prevCSA = testClient.readCSA(0);
+                        prevCSA = results[1];
                     testClient.powerOn(slot);
-                    var currCSA = testClient.readCSA(0);
+                    results = testClient.batch().readCSA(0).readCSA(0).submit();
+                    var currCSA = results[0];
                     if (currCSA === 0)
-                        currCSA = testClient.readCSA(0);
+                        currCSA = results[1];
 
                     if((currCSA - prevCSA) > 15)
                     {
@@ -452,28 +603,35 @@ GeneralCommands =
     {
         actionHintWidget.showProgressHint("Reading device's IDs...");
 
-        for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        let results = railtestForCheckedDuts("getmemw 0x0FE081F0 2", true);
+
+        for (let i = 0; i < results.length; i++)
         {
-            for (let i = 0; i < testClientList.length; i++)
+            let testClient = results[i].testClient;
+            let slot = results[i].slot;
+            let words = [];
+
+            // getmemw prints {{address}{value}} records.
+            for (let j = 0; j < results[i].response.length; j++)
             {
-                if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
-                {
-                    let testClient = testClientList[i];
-                    let response = testClient.railtestCommand(slot, "getmemw 0x0FE081F0 2");
-                    if(response.length > 4)
-                    {
-                        let id = response[response.length - 1].slice(2) + response[response.length - 3].slice(2);
-                        testClient.setDutProperty(slot, "id", id.toUpperCase());
-                        logger.logSuccess("ID for DUT " + testClient.dutNo(slot) + " has been read: " + testClient.dutProperty(slot, "id"));
-                        logger.logDebug("ID for DUT " + testClient.dutNo(slot) + ": " + testClient.dutProperty(slot, "id"));
-                    }
+                let record = results[i].response[j];
 
-                    else
-                    {
-                       logger.logError("Couldn't read ID for DUT " + testClient.dutNo(slot));
-                       logger.logDebug("Couldn't read ID for DUT " + testClient.dutNo(slot));
-                    }
-                }
+                if(record.name === "" && record.values.length === 2)
+                    words.push(record.values[1]);
+            }
+
+            if(words.length === 2)
+            {
+                let id = words[1].slice(2) + words[0].slice(2);
+                testClient.setDutProperty(slot, "id", id.toUpperCase());
+                logger.logSuccess("ID for DUT " + testClient.dutNo(slot) + " has been read: " + testClient.dutProperty(slot, "id"));
+                logger.logDebug("ID for DUT " + testClient.dutNo(slot) + ": " + testClient.dutProperty(slot, "id"));
+            }
+
+            else
+            {
+               logger.logError("Couldn't read ID for DUT " + testClient.dutNo(slot));
+               logger.logDebug("Couldn't read ID for DUT " + testClient.dutNo(slot));
             }
         }
 
@@ -486,19 +644,16 @@ GeneralCommands =
     {
         actionHintWidget.showProgressHint("Reading RTC values...");
 
-        for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        let results = railtestForCheckedDuts("rtc");
+
+        for (let i = 0; i < results.length; i++)
         {
-            for (let i = 0; i < testClientList.length; i++)
-            {
-                if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
-                {
-                    let testClient = testClientList[i];
-                    let response = testClient.railtestCommand(slot, "rtc");
+            let testClient = results[i].testClient;
+            let slot = results[i].slot;
+            let response = results[i].response;
 
-                    logger.logInfo("Current RTC value for DUT " + testClient.dutNo(slot) + " has been read.");
-                    logger.logDebug("RTC value for DUT " + testClient.dutNo(slot) + ": " + response.slice(7));
-                }
-            }
+            logger.logInfo("Current RTC value for DUT " + testClient.dutNo(slot) + " has been read.");
+            logger.logDebug("RTC value for DUT " + testClient.dutNo(slot) + ": " + response.slice(7));
         }
 
         actionHintWidget.showProgressHint("READY");
@@ -510,65 +665,56 @@ GeneralCommands =
     {
         actionHintWidget.showProgressHint("Testing Accelerometer...");
 
-        for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        let results = railtestForCheckedDuts("accl", true);
+
+        for (let i = 0; i < results.length; i++)
         {
-            for (let i = 0; i < testClientList.length; i++)
+            let testClient = results[i].testClient;
+            let slot = results[i].slot;
+            let records = results[i].response;
+            let responseString = JSON.stringify(records);
+            let accl = null;
+
+            for (let j = 0; j < records.length; j++)
             {
-                if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
+                let params = records[j].params;
+
+                if (typeof params.X === "number" && typeof params.Y === "number" && typeof params.Z === "number")
                 {
-                    let testClient = testClientList[i];
-                    let response = testClient.railtestCommand(slot, "accl");
-                    let patternFound = false;
+                    accl = params;
+                    break;
+                }
+            }
 
-                    if(response.length < 3)
-                    {
-                        testClient.setDutProperty(slot, "accelChecked", false);
-                        testClient.addDutError(slot, response.join(' '));
-                        logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". No response recieved.");
-                        logger.logDebug("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". No response recieved.");
-                    }
+            if(records.length === 0)
+            {
+                testClient.setDutProperty(slot, "accelChecked", false);
+                testClient.addDutError(slot, responseString);
+                logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". No response recieved.");
+                logger.logDebug("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". No response recieved.");
+            }
 
-                    else
-                    {
-                        for (let j = 0; j < response.length; j++)
-                        {
-                            if((j + 2) < response.length)
-                            {
-                                if (response[j].includes("X") && response[j + 1].includes("Y") && response[j + 2].includes("Z"))
-                                {
-                                    patternFound = true;
-                                    let x = Number(response[j].slice(2, 5));
-                                    let y = Number(response[j + 1].slice(2, 5));
-                                    let z = Number(response[j + 2].slice(2, 5));
-
-                                    if (x > 10 || x < -10 || y > 10 || y < -10 || z < -90 || z > 100)
-                                    {
-                                        testClient.setDutProperty(slot, "accelChecked", false);
-                                        testClient.addDutError(slot, response.join(' '));
-                                        logger.logDebug("Accelerometer failure for DUT " + testClient.dutNo(slot) + "; X=" + x +", Y=" + y + ", Z=" + z + ".");
-                                        logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot));
-                                    }
-                                    else
-                                    {
-                                        testClient.setDutProperty(slot, "accelChecked", true);
-                                        logger.logSuccess("Accelerometer for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
-                                        logger.logDebug("Accelerometer values for DUT " + testClient.dutNo(slot) + "; X=" + x +", Y=" + y + ", Z=" + z);
-                                    }
-
-                                    break;
-                                }
-                            }
-                        }
-                    }
+            else if(accl === null)
+            {
+                testClient.setDutProperty(slot, "accelChecked", false);
+                testClient.addDutError(slot, responseString);
+                logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". Invalid response recieved.");
+                logger.logDebug("Accelerometer failure. Invalid response: " + responseString);
+            }
 
-                    if(!patternFound)
-                    {
-                        testClient.setDutProperty(slot, "accelChecked", false);
-                        testClient.addDutError(slot, response.join(' '));
-                        logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". Invalid response recieved.");
-                        logger.logDebug("Accelerometer failure. Invalid response: " + response);
-                    }
-                }
+            else if (accl.X > 10 || accl.X < -10 || accl.Y > 10 || accl.Y < -10 || accl.Z < -90 || accl.Z > 100)
+            {
+                testClient.setDutProperty(slot, "accelChecked", false);
+                testClient.addDutError(slot, responseString);
+                logger.logDebug("Accelerometer failure for DUT " + testClient.dutNo(slot) + "; X=" + accl.X +", Y=" + accl.Y + ", Z=" + accl.Z + ".");
+                logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot));
+            }
+
+            else
+            {
+                testClient.setDutProperty(slot, "accelChecked", true);
+                logger.logSuccess("Accelerometer for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
+                logger.logDebug("Accelerometer values for DUT " + testClient.dutNo(slot) + "; X=" + accl.X +", Y=" + accl.Y + ", Z=" + accl.Z);
             }
         }
 
@@ -581,47 +727,46 @@ GeneralCommands =
     {
         actionHintWidget.showProgressHint("Testing light sensor...");
 
-        for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        let results = railtestForCheckedDuts("lsen", true);
+
+        for (let i = 0; i < results.length; i++)
         {
-            for (let i = 0; i < testClientList.length; i++)
+            let testClient = results[i].testClient;
+            let slot = results[i].slot;
+            let records = results[i].response;
+            let responseString = JSON.stringify(records);
+            let opwr = null;
+
+            for (let j = 0; j < records.length; j++)
             {
-                if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
+                if (typeof records[j].params.opwr === "number")
                 {
-                    let testClient = testClientList[i];
-                    let response = testClient.railtestCommand(slot, "lsen");
-                    let patternFound = false;
+                    opwr = records[j].params.opwr;
+                    break;
+                }
+            }
 
-                    if(response.length > 1)
-                    {
-                        if (response[2].includes("opwr"))
-                        {
-                            patternFound = true;
-                            let x = Number(response[2].slice(5, 5));
+            if(opwr === null)
+            {
+                testClient.setDutProperty(slot, "lightSensChecked", false);
+                testClient.addDutError(slot, responseString);
+                logger.logError("Light sensor failture for DUT " + testClient.dutNo(slot));
+                logger.logDebug("Light sensor failture for DUT " + testClient.dutNo(slot) + ": " + responseString);
+            }
 
-                            if (x < 0)
-                            {
-                                testClientList.setDutProperty(slot, "lightSensChecked", false);
-                                testClientList.addDutError(slot, response.join(' '));
-                                logger.logDebug("Light sensor failure: OPWR=" + x  + ".");
-                                logger.logError("Light sensor failture for DUT " + testClient.dutNo(slot));
-                            }
-                            else
-                            {
-                                testClient.setDutProperty(slot, "lightSensChecked", true);
-                                logger.logSuccess("Light sensor for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
-                                logger.logDebug("Light sensor value: OPWR=" + x);
-                            }
-                        }
-                    }
+            else if (opwr < 0)
+            {
+                testClient.setDutProperty(slot, "lightSensChecked", false);
+                testClient.addDutError(slot, responseString);
+                logger.logDebug("Light sensor failure: OPWR=" + opwr  + ".");
+                logger.logError("Light sensor failture for DUT " + testClient.dutNo(slot));
+            }
 
-                    if(!patternFound)
-                    {
-                        testClient.setDutProperty(slot, "lightSensChecked", false);
-                        testClient.addDutError(slot, response.join(' '));
-                        logger.logError("Light sensor failture for DUT " + testClient.dutNo(slot));
-                        logger.logDebug("Light sensor failture for DUT " + testClient.dutNo(slot) + ": " + response.join(' '));
-                    }
-                }
+            else
+            {
+                testClient.setDutProperty(slot, "lightSensChecked", true);
+                logger.logSuccess("Light sensor for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
+                logger.logDebug("Light sensor value: OPWR=" + opwr);
             }
         }
 
@@ -649,6 +794,91 @@ GeneralCommands =
         actionHintWidget.showProgressHint("READY");
     },
 
+   //---
+
+    // The same test for all boards at once: the DUTs in one slot position of every board
+    // transmit together, interleaved, and the reference module sorts the packets by DUT.
+    testRadioParallel: function (RfModuleId, channel, powerTable, minRSSI, maxRSSI, count)
+    {
+        actionHintWidget.showProgressHint("Testing radio interface...");
+
+        if(testClientList.length === 0)
+            return;
+
+        let radio = testClientList[0].referenceRadio(RfModuleId);
+
+        for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        {
+            let group = [];
+
+            for (let i = 0; i < testClientList.length; i++)
+            {
+                if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
+                    group.push(testClientList[i]);
+            }
+
+            if(group.length === 0)
+                continue;
+
+            if(!radio.listenBle(channel))
+            {
+                for (let j = 0; j < group.length; j++)
+                {
+                    group[j].addDutError(slot, radio.lastError());
+                    logger.logError("Radio Interface testing failure for DUT " + group[j].dutNo(slot) + ": " + radio.lastError());
+                }
+
+                continue;
+            }
+
+            let period = Math.max(RADIO_TX_DELAY, group.length * RADIO_SLOT_TIME);
+            let transmitting = [];
+
+            for (let j = 0; j < group.length; j++)
+            {
+                let no = group[j].dutNo(slot);
+
+                logger.logDebug("Radio testing for DUT " + no + " with power value: " + powerTable[no - 1]);
+                if(group[j].prepareRadioTx(slot, channel, powerTable[no - 1], period, RADIO_MARKER_OFFSET, no))
+                    transmitting.push(group[j]);
+            }
+
+            radio.startCapture(RADIO_MARKER_OFFSET);
+
+            for (let j = 0; j < transmitting.length; j++)
+            {
+                radio.waitUntil(j * RADIO_SLOT_TIME);
+                transmitting[j].startRadioTx(slot, count);
+            }
+
+            radio.waitUntil(transmitting.length * RADIO_SLOT_TIME + count * period + RADIO_TAIL_TIME);
+
+            let packets = radio.finishCapture();
+
+            // Nothing attributed at all: the module does not report payloads, test one DUT at a time.
+            if(transmitting.length > 0 && Object.keys(packets).length === 0)
+            {
+                logger.logDebug("Reference radio module reported no packet sources, testing the DUTs one at a time.");
+
+                for (let j = 0; j < transmitting.length; j++)
+                {
+                    let no = transmitting[j].dutNo(slot);
+                    transmitting[j].testRadio(slot, RfModuleId, channel, powerTable[no - 1], minRSSI, maxRSSI, count);
+                }
+
+                continue;
+            }
+
+            for (let j = 0; j < transmitting.length; j++)
+            {
+                let no = transmitting[j].dutNo(slot);
+                transmitting[j].checkRadio(slot, powerTable[no - 1], count, minRSSI, packets[no] || {});
+            }
+        }
+
+        actionHintWidget.showProgressHint("READY");
+    },
+
    //---
 
     testDALI: function ()
@@ -708,30 +938,27 @@ GeneralCommands =
         GeneralCommands.powerOn();
         delay(1000);
 
-        for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        let results = railtestForCheckedDuts("gnrx 3");
+
+        for (let i = 0; i < results.length; i++)
         {
-            for (let i = 0; i < testClientList.length; i++)
-            {
-                if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
-                {
-                    let testClient = testClientList[i];
-                    let responseString = testClient.railtestCommand(slot, "gnrx 3").join(' ');
-                    if (responseString.includes("line"))
-                    {
-                        testClient.setDutProperty(slot, "gnssChecked", true);
-                        logger.logSuccess("GNSS module for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
-                        logger.logDebug("GNSS module for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
-                    }
+            let testClient = results[i].testClient;
+            let slot = results[i].slot;
+            let responseString = results[i].response.join(' ');
 
-                    else
-                    {
-                        testClient.setDutProperty(slot, "gnssChecked", false);
-                        testClient.addDutError(slot, responseString);
-                        logger.logDebug("GNSS module failture: " + responseString);
-                        logger.logError("GNSS module failture for DUT " + testClient.dutNo(slot));
+            if (responseString.includes("line"))
+            {
+                testClient.setDutProperty(slot, "gnssChecked", true);
+                logger.logSuccess("GNSS module for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
+                logger.logDebug("GNSS module for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
+            }
 
-                    }
-                }
+            else
+            {
+                testClient.setDutProperty(slot, "gnssChecked", false);
+                testClient.addDutError(slot, responseString);
+                logger.logDebug("GNSS module failture: " + responseString);
+                logger.logError("GNSS module failture for DUT " + testClient.dutNo(slot));
             }
         }
 
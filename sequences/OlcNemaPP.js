@@ -215,7 +215,7 @@ NemaPP =
 
     testRadio: function ()
     {
-        GeneralCommands.testRadio(NemaPP.RfModuleId, 19, NemaPP.powerTable, -90, 0, 50);
+        GeneralCommands.testRadioParallel(NemaPP.RfModuleId, 19, NemaPP.powerTable, -90, 0, 50);
     },
 
     testRadioDebug: function ()
@@ -253,8 +253,7 @@ NemaPP =
                 {
                     let testClient = testClientList[i];
                     testClient.switchSWD(slot);
-                    testClient.powerOn(slot);
-                    delay(1000);
+                    testClient.ensurePowered(slot);
 
                     testClient.railtestCommand(slot, "dali 0xFE80 16 0 0");
                     let responseString = testClient.railtestCommand(slot, "dali 0xFF90 16 0 1000000").join(' ');
@@ -380,6 +379,9 @@ methodManager.addFunctionToGeneralList("Detect DUTs", NemaPP.detectDuts);
 methodManager.addFunctionToGeneralList("Download Railtest", NemaPP.downloadRailtest);
 methodManager.addFunctionToGeneralList("Read CSA", GeneralCommands.readCSA);
 methodManager.addFunctionToGeneralList("Read Temperature", GeneralCommands.readTemperature);
+methodManager.addFunctionToGeneralList("Log command latency statistics", GeneralCommands.logLatencyStatistics);
+methodManager.addFunctionToGeneralList("Raise railtest baud rate", GeneralCommands.raiseRailtestBaud);
+methodManager.addFunctionToGeneralList("Benchmark railtest link", GeneralCommands.benchmarkRailtest);
 methodManager.addFunctionToGeneralList("Supply power to DUTs", NemaPP.powerOn);
 //methodManager.addFunctionToGeneralList("Test radio debug", NemaPP.testRadioDebug);
 methodManager.addFunctionToGeneralList("Power off DUTs", NemaPP.powerOff);
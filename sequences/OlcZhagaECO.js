@@ -54,15 +54,17 @@ ZhagaECO =
                 testClient.setTimeout(300);
 //                logger.logDebug("Attempting connection to slot " + slot + " of board " + testClient.no() + "...");
 
-                let voltage = testClient.readAIN(slot, 1, 0);
-
-                let counter = 0;
-                while((voltage === 0 || voltage === -1) && (counter < 50))
+                // Readings 200 ms apart until the rail is stable. A rail settled at 0 (or failed reads)
+                // may still come up late, so sampling goes on up to 50 readings in all.
+                let voltage = -1;
+                let readings = 0;
+                do
                 {
-                    delay(200);
-                    voltage = testClient.readAIN(slot, 1, 0);
-                    counter++;
+                    let samples = testClient.sampleAIN(slot, 1, 0, 50 - readings, 200, 500);
+                    readings += samples.count + samples.errors;
+                    voltage = samples.settled;
                 }
+                while((voltage === 0 || voltage === -1) && readings < 50);
 
                 if(voltage > 70000 && voltage < 72000)
                 {
@@ -107,8 +109,10 @@ ZhagaECO =
                 let testClient = testClientList[i];
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
                 {
-                    let voltage = testClient.readAIN(slot, 1, 0);
-                    if(voltage > 69000 && voltage < 72000)
+                    // The mean of several readings, a single noisy one no longer fails the DUT.
+                    let samples = testClient.sampleAIN(slot, 1, 0, 8);
+                    let voltage = samples.mean;
+                    if(samples.count > 0 && voltage > 69000 && voltage < 72000)
                     {
                         testClientList[i].setDutProperty(slot, "voltageChecked", true);
                         logger.logSuccess("Voltage (3.3V) on AIN 1 for DUT " + testClientList[i].dutNo(slot) + " is checked.");
@@ -118,7 +122,7 @@ ZhagaECO =
                     {
                         testClientList[i].setDutProperty(slot, "voltageChecked", false);
                         testClientList[i].addDutError(slot, "Error voltage on AIN1");
-                        logger.logDebug("Error voltage value on AIN 1 : " + voltage  + ".");
+                        logger.logDebug("Error voltage value on AIN 1 : " + voltage  + " (" + samples.count + " readings, min " + samples.min + ", max " + samples.max + ", stddev " + samples.stddev.toFixed(1) + ").");
                         logger.logError("Error voltage value on AIN 1 is detected. DUT " + testClientList[i].dutNo(slot));
                     }
                 }
@@ -142,7 +146,7 @@ ZhagaECO =
 
     testRadio: function ()
     {
-        GeneralCommands.testRadio(ZhagaECO.RfModuleId, 19, ZhagaECO.powerTable, -90, 0, 50);
+        GeneralCommands.testRadioParallel(ZhagaECO.RfModuleId, 19, ZhagaECO.powerTable, -90, 0, 50);
     },
 
     //---
@@ -159,6 +163,7 @@ ZhagaECO =
         GeneralCommands.detectDuts();
         GeneralCommands.unlockAndEraseChip();
         ZhagaECO.downloadRailtest();
+        GeneralCommands.raiseRailtestBaud();
         GeneralCommands.readChipId();
         GeneralCommands.testDALI();
         ZhagaECO.checkAinVoltage();
@@ -218,6 +223,9 @@ methodManager.addFunctionToGeneralList("Unlock and erase chip", GeneralCommands.
 methodManager.addFunctionToGeneralList("Download Railtest", ZhagaECO.downloadRailtest);
 methodManager.addFunctionToGeneralList("Read CSA", GeneralCommands.readCSA);
 methodManager.addFunctionToGeneralList("Read Temperature", GeneralCommands.readTemperature);
+methodManager.addFunctionToGeneralList("Log command latency statistics", GeneralCommands.logLatencyStatistics);
+methodManager.addFunctionToGeneralList("Raise railtest baud rate", GeneralCommands.raiseRailtestBaud);
+methodManager.addFunctionToGeneralList("Benchmark railtest link", GeneralCommands.benchmarkRailtest);
 methodManager.addFunctionToGeneralList("Supply power to DUTs", GeneralCommands.powerOn);
 methodManager.addFunctionToGeneralList("Power off DUTs", GeneralCommands.powerOff);
 methodManager.addFunctionToGeneralList("Read unique device identifiers (ID)", GeneralCommands.readChipId);
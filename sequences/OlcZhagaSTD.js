@@ -25,8 +25,7 @@ ZhagaSTD =
                 let jlink = jlinkList[i];
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
                 {
-                    testClient.powerOn(slot);
-                    delay(1000);
+                    testClient.ensurePowered(slot);
                     testClient.switchSWD(slot);
 
                     jlink.selectByUSB();
@@ -82,8 +81,7 @@ ZhagaSTD =
                 let jlink = jlinkList[i];
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot) && (testClient.dutState(slot) === 2))
                 {
-                    testClient.powerOn(slot);
-                    delay(1000);
+                    testClient.ensurePowered(slot);
                     testClient.switchSWD(slot);
 
                     jlink.selectByUSB();
@@ -0,0 +1,559 @@
+#include "BoardSimulator.h"
+#include "SlipProtocol.h"
+#include "CrcCcitt.h"
+
+#include <QFile>
+#include <QtEndian>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// DUT output is forwarded in chunks, the way the board relays the DUT UART.
+static constexpr int RAILTEST_CHUNK_SIZE = 128;
+
+// Railtest starts at this rate, and so does the board's channel to the DUT.
+static constexpr int DEFAULT_DUT_BAUD = 115200;
+
+static QByteArray _int32BigEndian(qint32 value)
+{
+    QByteArray data(sizeof(value), 0);
+
+    qToBigEndian(value, data.data());
+    return data;
+}
+
+static QByteArray _settingsString(QSettings &settings, const QString &key)
+{
+    // Unquoted INI values with commas come back as lists.
+    auto value = settings.value(key);
+
+    if (value.type() == QVariant::StringList)
+        return value.toStringList().join(',').toUtf8();
+
+    return value.toString().toUtf8();
+}
+
+BoardSimulator::BoardSimulator(QSettings &settings, const QString &group, QObject *parent) : QObject(parent)
+{
+    loadSettings(settings, group);
+
+    _decoder.setFrameHandler([this](quint8 channel, const char *payload, int size)
+    {
+        onFrame(channel, payload, size);
+    });
+    _decoder.setErrorHandler([this](SlipDecoder::Error)
+    {
+        sendPacket(MB_ASYNC_EVENT, 0, _int32BigEndian(MB_EVENT_SLIP_ERROR));
+    });
+
+    connect(&_eventTimer, &QTimer::timeout, this, &BoardSimulator::onEventTimerTimeout);
+}
+
+BoardSimulator::~BoardSimulator()
+{
+    if (!_linkPath.isEmpty())
+        QFile::remove(_linkPath);
+
+    if (_slave != -1)
+        ::close(_slave);
+
+    if (_master != -1)
+        ::close(_master);
+}
+
+void BoardSimulator::loadSettings(QSettings &settings, const QString &group)
+{
+    settings.beginGroup(group);
+
+    _linkPath = settings.value("link").toString();
+    _commandLatency = settings.value("commandLatency", 0).toInt();
+    _batchSupported = settings.value("batch", true).toBool();
+    _queueDepth = settings.value("queueDepth", 0).toInt();
+    _baudCommand = settings.value("baudCommand", "setBaudRate").toByteArray();
+    _csaBase = settings.value("csaBase", 10).toInt();
+    _eventCode = settings.value("eventCode", 0).toInt();
+
+    for (auto & key : QStringList {"adc24V", "adc3V", "adcTemp", "daliAdc"})
+        _readings.insert(key, settings.value(key, 0));
+
+    if (settings.value("eventInterval", 0).toInt() > 0)
+        _eventTimer.setInterval(settings.value("eventInterval").toInt());
+
+    for (int slot = 1; slot < 4; ++slot)
+    {
+        auto &dut = _duts[slot];
+
+        settings.beginGroup(QString("dut%1").arg(slot));
+
+        dut.present = settings.value("present", false).toBool();
+        dut.currentDraw = settings.value("current", 30).toInt();
+        dut.latency = settings.value("latency", 0).toInt();
+        dut.maxBaud = settings.value("maxBaud", 921600).toInt();
+
+        for (auto & key : settings.childKeys())
+            dut.readings.insert(key, settings.value(key));
+
+        settings.beginGroup("railtest");
+        for (auto & command : settings.childKeys())
+            dut.railtest.insert(command.toUtf8(), _settingsString(settings, command));
+        settings.endGroup();
+
+        settings.endGroup();
+    }
+
+    settings.endGroup();
+}
+
+bool BoardSimulator::start()
+{
+    _master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (_master == -1 || grantpt(_master) != 0 || unlockpt(_master) != 0)
+        return false;
+
+    _slavePath = QString::fromLocal8Bit(ptsname(_master));
+
+    // A slave descriptor is kept open, otherwise the master reads EIO whenever the station
+    // has the port closed and data written meanwhile is lost.
+    _slave = ::open(_slavePath.toLocal8Bit().constData(), O_RDWR | O_NOCTTY);
+    if (_slave == -1)
+        return false;
+
+    termios attributes;
+
+    tcgetattr(_slave, &attributes);
+    cfmakeraw(&attributes);
+    tcsetattr(_slave, TCSANOW, &attributes);
+
+    fcntl(_master, F_SETFL, fcntl(_master, F_GETFL) | O_NONBLOCK);
+
+    if (!_linkPath.isEmpty())
+    {
+        QFile::remove(_linkPath);
+        if (symlink(_slavePath.toLocal8Bit().constData(), _linkPath.toLocal8Bit().constData()) != 0)
+            _linkPath.clear();
+    }
+
+    _notifier = new QSocketNotifier(_master, QSocketNotifier::Read, this);
+    connect(_notifier, &QSocketNotifier::activated, this, &BoardSimulator::onMasterReadyRead);
+    _writeNotifier = new QSocketNotifier(_master, QSocketNotifier::Write, this);
+    _writeNotifier->setEnabled(false);
+    connect(_writeNotifier, &QSocketNotifier::activated, this, &BoardSimulator::flushTx);
+
+    if (_eventTimer.interval() > 0)
+        _eventTimer.start();
+
+    sendPacket(MB_STARTUP, 0, QByteArray());
+    return true;
+}
+
+void BoardSimulator::onMasterReadyRead()
+{
+    char buffer[4096];
+    ssize_t size;
+
+    while ((size = ::read(_master, buffer, sizeof(buffer))) > 0)
+        _decoder.feed(buffer, int(size));
+}
+
+void BoardSimulator::onEventTimerTimeout()
+{
+    sendPacket(MB_ASYNC_EVENT, 0, _int32BigEndian(_eventCode));
+}
+
+void BoardSimulator::onFrame(quint8 channel, const char *payload, int size)
+{
+    if (channel == 0)
+        handleCommand(payload, size);
+    else if (channel <= 3)
+        handleRailtest(channel, payload, size);
+    else
+        sendPacket(MB_ASYNC_EVENT, 0, _int32BigEndian(MB_EVENT_INVALID_CHANNEL));
+}
+
+void BoardSimulator::handleCommand(const char *packet, int size)
+{
+    if (size < (int)sizeof(MB_Packet_t))
+    {
+        sendPacket(MB_GENERAL_RESULT, 0, _int32BigEndian(MB_ERROR_COMMAND_TOO_SHORT));
+        return;
+    }
+
+    MB_Packet_t header;
+
+    memcpy(&header, packet, sizeof(header));
+
+    quint16 type = qFromBigEndian(header.type);
+    auto data = reinterpret_cast<const quint8*>(packet) + sizeof(header);
+    int dataSize = size - int(sizeof(header));
+    qint32 result;
+
+    // Like the firmware, a command that finds the queue full is dropped and reported.
+    if (_queueDepth > 0 && _queuedReplies >= _queueDepth)
+    {
+        sendPacket(MB_ASYNC_EVENT, 0, _int32BigEndian(MB_EVENT_CMDQUEUE_FULL));
+        return;
+    }
+
+    ++_commandsHandled;
+
+    if (type == MB_SYSTEM_RESET)
+    {
+        for (auto & dut : _duts)
+        {
+            dut.powered = false;
+            dut.boardBaud = DEFAULT_DUT_BAUD;
+        }
+        _daliOn = false;
+
+        QByteArray startup(sizeof(MB_Packet_t), 0);
+
+        qToBigEndian<quint16>(MB_STARTUP, startup.data());
+        startup[2] = char(header.sequence);
+        queueReply(startup);
+        return;
+    }
+
+    if (type == MB_BATCH && _batchSupported && dataSize == header.dataLen)
+    {
+        handleBatch(header.sequence, data, dataSize);
+        return;
+    }
+
+    if (dataSize != header.dataLen)
+        result = MB_ERROR_INVALID_DATA_SIZE;
+    else
+        result = executeCommand(type, data, dataSize);
+
+    QByteArray reply(sizeof(MB_Packet_t), 0);
+
+    qToBigEndian<quint16>(MB_GENERAL_RESULT, reply.data());
+    reply[2] = char(header.sequence);
+    reply[3] = char(sizeof(result));
+    reply += _int32BigEndian(result);
+
+    queueReply(reply);
+}
+
+void BoardSimulator::handleBatch(quint8 sequence, const quint8 *data, int size)
+{
+    // A malformed batch is rejected as a whole before any of its requests runs.
+    int count = 0;
+    int pos = 0;
+
+    while (size - pos >= (int)sizeof(MB_Packet_t))
+    {
+        pos += sizeof(MB_Packet_t) + data[pos + 3];
+        ++count;
+    }
+
+    if (pos != size || count > MB_BATCH_MAX_COMMANDS)
+    {
+        sendPacket(MB_GENERAL_RESULT, sequence, _int32BigEndian(MB_ERROR_INVALID_DATA_SIZE));
+        return;
+    }
+
+    QByteArray results;
+
+    for (pos = 0; pos < size; pos += sizeof(MB_Packet_t) + data[pos + 3])
+    {
+        quint16 type = qFromBigEndian<quint16>(data + pos);
+
+        // Neither a reset nor a nested batch can be part of a batch.
+        if (type == MB_SYSTEM_RESET || type == MB_BATCH)
+            results += _int32BigEndian(MB_ERROR_INVALID_PACKET_TYPE);
+        else
+            results += _int32BigEndian(executeCommand(type, data + pos + sizeof(MB_Packet_t), data[pos + 3]));
+    }
+
+    QByteArray reply(sizeof(MB_Packet_t), 0);
+
+    qToBigEndian<quint16>(MB_BATCH_RESULT, reply.data());
+    reply[2] = char(sequence);
+    reply[3] = char(results.size());
+    reply += results;
+
+    queueReply(reply);
+}
+
+qint32 BoardSimulator::executeCommand(quint16 type, const quint8 *data, int size)
+{
+    auto isDut = [data](int index) {return data[index] >= 1 && data[index] <= 3;};
+    auto reading = [this, data](const QString &key) {return _duts[data[0]].readings.value(key.arg(data[1]), 0).toInt();};
+
+    switch (type)
+    {
+        case MB_SWITCH_SWD:
+            if (size != 1)
+                return MB_ERROR_INVALID_DATA_SIZE;
+            return isDut(0) ? MB_NO_ERROR : MB_ERROR_INVALID_ARGUMENT;
+
+        case MB_SWITCH_POWER:
+            if (size != 2)
+                return MB_ERROR_INVALID_DATA_SIZE;
+            if (!isDut(0) || data[1] > 1)
+                return MB_ERROR_INVALID_ARGUMENT;
+            _duts[data[0]].powered = data[1];
+
+            // Railtest boots at the default rate again.
+            if (!data[1])
+                _duts[data[0]].dutBaud = DEFAULT_DUT_BAUD;
+            return MB_NO_ERROR;
+
+        case MB_READ_DIN:
+            if (size != 2)
+                return MB_ERROR_INVALID_DATA_SIZE;
+            return isDut(0) ? reading("din%1") : MB_ERROR_INVALID_ARGUMENT;
+
+        case MB_WRITE_DOUT:
+            if (size != 3)
+                return MB_ERROR_INVALID_DATA_SIZE;
+            return (isDut(0) && data[2] <= 1) ? MB_NO_ERROR : MB_ERROR_INVALID_ARGUMENT;
+
+        case MB_READ_CSA:
+        {
+            if (size != 1)
+                return MB_ERROR_INVALID_DATA_SIZE;
+
+            // The current sense amplifier sees every powered DUT.
+            qint32 current = _csaBase;
+
+            for (auto & dut : _duts)
+            {
+                if (dut.present && dut.powered)
+                    current += dut.currentDraw;
+            }
+
+            return current;
+        }
+
+        case MB_READ_ANALOG:
+            if (size != 3)
+                return MB_ERROR_INVALID_DATA_SIZE;
+            return isDut(0) ? reading("ain%1") : MB_ERROR_INVALID_ARGUMENT;
+
+        case MB_CONFIG_DUT_DEBUG:
+        {
+            if (size != 8)
+                return MB_ERROR_INVALID_DATA_SIZE;
+
+            auto baudRate = qFromBigEndian<quint32>(data + 1);
+
+            if (!isDut(0) || baudRate == 0 || (data[5] != 8 && data[5] != 9) || data[6] > 2 || data[7] < 1 || data[7] > 2)
+                return MB_ERROR_INVALID_ARGUMENT;
+
+            _duts[data[0]].boardBaud = int(baudRate);
+            return MB_NO_ERROR;
+        }
+
+        case MB_SWITCH_DALI:
+            if (size != 1)
+                return MB_ERROR_INVALID_DATA_SIZE;
+            if (data[0] > 1)
+                return MB_ERROR_INVALID_ARGUMENT;
+            _daliOn = data[0];
+            return MB_NO_ERROR;
+
+        case MB_READ_DALI_ADC:
+            if (size != 0)
+                return MB_ERROR_INVALID_DATA_SIZE;
+            return _daliOn ? _readings.value("daliAdc").toInt() : 0;
+
+        case MB_READ_DIN_ADC:
+            if (size != 2)
+                return MB_ERROR_INVALID_DATA_SIZE;
+            return isDut(0) ? reading("dinAdc%1") : MB_ERROR_INVALID_ARGUMENT;
+
+        case MB_READ_ADC_24V:
+            return size ? MB_ERROR_INVALID_DATA_SIZE : _readings.value("adc24V").toInt();
+
+        case MB_READ_ADC_3V:
+            return size ? MB_ERROR_INVALID_DATA_SIZE : _readings.value("adc3V").toInt();
+
+        case MB_READ_ADC_TEMP:
+            return size ? MB_ERROR_INVALID_DATA_SIZE : _readings.value("adcTemp").toInt();
+    }
+
+    return MB_ERROR_INVALID_PACKET_TYPE;
+}
+
+void BoardSimulator::handleRailtest(int slot, const char *data, int size)
+{
+    auto &dut = _duts[slot];
+
+    // A DUT that is missing or not powered does not answer, neither does one that only gets
+    // garbage because the rates differ or the link cannot carry its rate.
+    if (!dut.present || !dut.powered || dut.boardBaud != dut.dutBaud || dut.dutBaud > dut.maxBaud)
+    {
+        dut.pending.clear();
+        return;
+    }
+
+    dut.pending.append(data, size);
+
+    int end = dut.pending.lastIndexOf('\n');
+
+    if (end == -1)
+        return;
+
+    auto lines = dut.pending.left(end).split('\n');
+    QByteArray output;
+    int nextBaud = dut.dutBaud;
+
+    dut.pending.remove(0, end + 1);
+
+    // One prompt per received chunk: the station sends "command\r\n\r\n" and waits for "> ".
+    for (auto line : lines)
+    {
+        line = line.trimmed();
+        if (line.isEmpty())
+            continue;
+
+        auto name = line.split(' ').first();
+        auto response = dut.railtest.value(line, dut.railtest.value(name));
+
+        // Rate changes and resets take effect after the reply, which still goes out at the old rate.
+        if (name == _baudCommand)
+        {
+            int baudRate = line.split(' ').value(1).toInt();
+
+            if (baudRate > 0)
+            {
+                response = "{{(" + name + ")}{baud:" + QByteArray::number(baudRate) + "}}";
+                nextBaud = baudRate;
+            }
+
+            else
+            {
+                response = "{{(" + name + ")}{error:invalid rate}}";
+            }
+        }
+
+        else if (name == "reset")
+        {
+            response = "{{(reset)}{status:restarting}}";
+            nextBaud = DEFAULT_DUT_BAUD;
+        }
+
+        if (response.isNull())
+            response = "{{(" + name + ")}{error:unknown command}}";
+
+        output += line + "\r\n" + response + "\r\n";
+    }
+
+    if (output.isEmpty())
+        output = "\r\n";
+
+    // The prompt goes out with the last chunk, so it is never split. Each chunk arrives
+    // once the DUT UART has shifted it out, 10 bits per octet.
+    double transmitTime = 0;
+
+    for (int pos = 0; pos < output.size(); pos += RAILTEST_CHUNK_SIZE)
+    {
+        auto chunk = output.mid(pos, RAILTEST_CHUNK_SIZE);
+
+        if (pos + RAILTEST_CHUNK_SIZE >= output.size())
+            chunk += "> ";
+
+        transmitTime += chunk.size() * 10 * 1000.0 / dut.dutBaud;
+        sendDelayed(dut.latency + int(transmitTime), quint8(slot), chunk);
+    }
+
+    dut.dutBaud = nextBaud;
+}
+
+void BoardSimulator::sendPacket(quint16 type, quint8 sequence, const QByteArray &data)
+{
+    QByteArray packet(sizeof(MB_Packet_t), 0);
+
+    qToBigEndian(type, packet.data());
+    packet[2] = char(sequence);
+    packet[3] = char(data.size());
+
+    sendFrame(0, packet + data);
+}
+
+void BoardSimulator::queueReply(const QByteArray &reply)
+{
+    if (_commandLatency <= 0)
+    {
+        sendFrame(0, reply);
+        return;
+    }
+
+    ++_queuedReplies;
+
+    QTimer::singleShot(_commandLatency, Qt::PreciseTimer, this, [this, reply]()
+    {
+        --_queuedReplies;
+        sendFrame(0, reply);
+    });
+}
+
+void BoardSimulator::sendDelayed(int latency, quint8 channel, const QByteArray &payload)
+{
+    if (latency <= 0)
+    {
+        sendFrame(channel, payload);
+        return;
+    }
+
+    QTimer::singleShot(latency, Qt::PreciseTimer, this, [this, channel, payload]()
+    {
+        sendFrame(channel, payload);
+    });
+}
+
+void BoardSimulator::sendFrame(quint8 channel, const QByteArray &payload)
+{
+    quint16 crc = crcCcitt(crcCcitt(CRC_CCITT_INIT, &channel, 1), payload.constData(), payload.size());
+    QByteArray frame;
+
+    frame.reserve((payload.size() + 3) * 2 + 2);
+    frame.append(SlipDecoder::END_OCTET);
+
+    auto append = [&frame](char ch)
+    {
+        if (ch == SlipDecoder::END_OCTET)
+            frame.append(SlipDecoder::ESC_OCTET).append(SlipDecoder::END_SUBS_OCTET);
+        else if (ch == SlipDecoder::ESC_OCTET)
+            frame.append(SlipDecoder::ESC_OCTET).append(SlipDecoder::ESC_SUBS_OCTET);
+        else
+            frame.append(ch);
+    };
+
+    append(char(channel));
+    for (char ch : payload)
+        append(ch);
+    append(char(crc >> 8));
+    append(char(crc & 0xFF));
+    frame.append(SlipDecoder::END_OCTET);
+
+    _txBuffer += frame;
+    flushTx();
+}
+
+void BoardSimulator::flushTx()
+{
+    while (!_txBuffer.isEmpty())
+    {
+        ssize_t written = ::write(_master, _txBuffer.constData(), _txBuffer.size());
+
+        if (written <= 0)
+        {
+            // The terminal buffer is full until the station reads; retry when writable.
+            if (written == -1 && errno == EAGAIN && _writeNotifier)
+                _writeNotifier->setEnabled(true);
+            return;
+        }
+
+        _txBuffer.remove(0, int(written));
+    }
+
+    if (_writeNotifier)
+        _writeNotifier->setEnabled(false);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QObject>
+#include <QSettings>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include "SlipDecoder.h"
+
+// One virtual measuring board on a pseudo-terminal.
+//
+// The station opens the slave side like the USB serial port of a real board. The
+// simulator answers the SlipProtocol.h commands on channel 0 with MB_GENERAL_RESULT
+// (MB_STARTUP after a reset, MB_BATCH_RESULT to a batch), reports SLIP errors and bad
+// channels as async events and plays railtest on channels 1-3 for every DUT that is
+// present and powered. Readings, DUT responses and latencies come from the board's
+// settings group.
+
+class BoardSimulator : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    BoardSimulator(QSettings &settings, const QString &group, QObject *parent = nullptr);
+    ~BoardSimulator();
+
+    bool start();
+    QString slavePath() const {return _slavePath;}
+    QString linkPath() const {return _linkPath;}
+
+    quint64 commandsHandled() const {return _commandsHandled;}
+
+private slots:
+
+    void onMasterReadyRead();
+    void onEventTimerTimeout();
+    void flushTx();
+
+private:
+
+    struct Dut
+    {
+        bool present = false;
+        bool powered = false;
+        int currentDraw = 0;
+        int latency = 0;
+        int dutBaud = 115200;
+        int boardBaud = 115200;
+        int maxBaud = 921600;
+        QByteArray pending;
+        QMap<QString, QVariant> readings;
+        QMap<QByteArray, QByteArray> railtest;
+    };
+
+    void loadSettings(QSettings &settings, const QString &group);
+    void onFrame(quint8 channel, const char *payload, int size);
+    void handleCommand(const char *packet, int size);
+    void handleBatch(quint8 sequence, const quint8 *data, int size);
+    qint32 executeCommand(quint16 type, const quint8 *data, int size);
+    void handleRailtest(int slot, const char *data, int size);
+
+    void sendPacket(quint16 type, quint8 sequence, const QByteArray &data);
+    void sendFrame(quint8 channel, const QByteArray &payload);
+    void sendDelayed(int latency, quint8 channel, const QByteArray &payload);
+    void queueReply(const QByteArray &reply);
+
+    int _master = -1;
+    int _slave = -1;
+    QString _slavePath;
+    QString _linkPath;
+    QSocketNotifier *_notifier = nullptr;
+    QSocketNotifier *_writeNotifier = nullptr;
+    QByteArray _txBuffer;
+    SlipDecoder _decoder;
+
+    int _commandLatency = 0;
+    bool _batchSupported = true;
+    int _queueDepth = 0;
+    int _queuedReplies = 0;
+    QByteArray _baudCommand;
+    int _csaBase = 0;
+    bool _daliOn = false;
+    QMap<QString, QVariant> _readings;
+    Dut _duts[4];
+
+    QTimer _eventTimer;
+    qint32 _eventCode = 0;
+
+    quint64 _commandsHandled = 0;
+};
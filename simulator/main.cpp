@@ -0,0 +1,66 @@
+#include "BoardSimulator.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QTimer>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    a.setApplicationName("MeasuringBoardSimulator");
+
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Virtual measuring boards on pseudo-terminals.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("config", "Simulator INI file.", "[config]");
+    parser.process(a);
+
+    auto configFile = parser.positionalArguments().value(0, a.applicationDirPath() + "/simulator.ini");
+    QSettings settings(configFile, QSettings::IniFormat);
+    QTextStream out(stdout);
+    QList<BoardSimulator*> boards;
+
+    for (int i = 1; i <= settings.value("boards", 1).toInt(); ++i)
+    {
+        auto board = new BoardSimulator(settings, QString("Board%1").arg(i), &a);
+
+        if (!board->start())
+        {
+            out << "Board " << i << ": cannot create a pseudo-terminal.\n";
+            return 1;
+        }
+
+        out << "Board " << i << ": " << board->slavePath();
+        if (!board->linkPath().isEmpty())
+            out << " (" << board->linkPath() << ")";
+        out << "\n";
+        boards.append(board);
+    }
+
+    out.flush();
+
+    // Command rate report, for load tests.
+    int reportInterval = settings.value("reportInterval", 0).toInt();
+    QTimer reportTimer;
+    quint64 lastCount = 0;
+
+    QObject::connect(&reportTimer, &QTimer::timeout, [&]()
+    {
+        quint64 count = 0;
+
+        for (auto board : boards)
+            count += board->commandsHandled();
+
+        out << "Commands: " << count << ", " << (count - lastCount) * 1000.0 / reportInterval << "/s\n";
+        out.flush();
+        lastCount = count;
+    });
+
+    if (reportInterval > 0)
+        reportTimer.start(reportInterval);
+
+    return a.exec();
+}